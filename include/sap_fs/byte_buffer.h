@@ -0,0 +1,78 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace sap::fs {
+
+    // Growable byte buffer that never zero-fills: bytes exposed by growing are uninitialized
+    class ByteBuffer {
+    public:
+        ByteBuffer() = default;
+        explicit ByteBuffer(size_t size) { resize(size); }
+        ByteBuffer(ByteBuffer&& other) noexcept;
+        ByteBuffer& operator=(ByteBuffer&& other) noexcept;
+        ByteBuffer(const ByteBuffer&) = delete;
+        ByteBuffer& operator=(const ByteBuffer&) = delete;
+
+        [[nodiscard]] u8* data() { return m_Data.get(); }
+        [[nodiscard]] const u8* data() const { return m_Data.get(); }
+        [[nodiscard]] size_t size() const { return m_Size; }
+        [[nodiscard]] size_t capacity() const { return m_Capacity; }
+        [[nodiscard]] bool empty() const { return m_Size == 0; }
+        [[nodiscard]] u8* begin() { return data(); }
+        [[nodiscard]] u8* end() { return data() + m_Size; }
+        [[nodiscard]] const u8* begin() const { return data(); }
+        [[nodiscard]] const u8* end() const { return data() + m_Size; }
+        [[nodiscard]] std::span<u8> span() { return {data(), m_Size}; }
+        [[nodiscard]] std::span<const u8> span() const { return {data(), m_Size}; }
+        [[nodiscard]] u8& operator[](size_t index) { return m_Data[index]; }
+        [[nodiscard]] u8 operator[](size_t index) const { return m_Data[index]; }
+
+        // Change the size; existing bytes are kept, new bytes are left uninitialized
+        void resize(size_t size);
+        // Ensure capacity without changing the size
+        void reserve(size_t capacity);
+        // Drop the contents but keep the allocation
+        void clear() { m_Size = 0; }
+
+    private:
+        std::unique_ptr<u8[]> m_Data;
+        size_t m_Size = 0;
+        size_t m_Capacity = 0;
+    };
+
+    // Thread-safe pool of ByteBuffers in power-of-two size classes. Once warmed up, repeated loads of similar
+    // sizes reuse already-faulted memory instead of allocating (and zeroing) fresh pages.
+    class BufferPool {
+    public:
+        static constexpr size_t s_MinClassShift = 12;
+        static constexpr size_t s_ClassCount = 20;
+
+        // Keep at most max_cached_bytes of released buffers around
+        explicit BufferPool(size_t max_cached_bytes = 256 * 1024 * 1024) : m_MaxCachedBytes(max_cached_bytes) {}
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // Buffer of the given size with unspecified contents
+        [[nodiscard]] ByteBuffer acquire(size_t size);
+        // Hand a buffer back for reuse; dropped if the pool is full or the buffer is outside the size classes
+        void release(ByteBuffer buffer);
+        // Bytes currently held for reuse
+        [[nodiscard]] size_t cached_bytes() const;
+        // Free every cached buffer
+        void trim();
+
+    private:
+        mutable std::mutex m_Mutex;
+        std::array<std::vector<ByteBuffer>, s_ClassCount> m_Classes;
+        size_t m_CachedBytes = 0;
+        size_t m_MaxCachedBytes;
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include "sap_fs/file_info.h"
+#include "sap_fs/path_list.h"
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs {
+
+    namespace detail {
+        class LockStripes;
+        class NegativeCache;
+        class UniqueFd;
+    } // namespace detail
+
+    // Open subdirectory of a Filesystem. Names are resolved relative to the directory's descriptor with *at()
+    // syscalls, so each lookup walks only the name's own components instead of the full path from the root.
+    // Names must be relative and free of ".." components; the kernel keeps symlinks from leading out of the
+    // directory. The handle stays valid if the directory is renamed. Copies share the descriptor.
+    class Dir {
+    public:
+        // Path of this directory relative to the filesystem root ("" for the root itself)
+        [[nodiscard]] const std::string& path() const { return m_Path; }
+
+        [[nodiscard]] bool exists(std::string_view name) const;
+        // Metadata with symlinks followed, as Filesystem::stat
+        [[nodiscard]] stl::result<FileInfo> stat(std::string_view name) const;
+        [[nodiscard]] stl::result<std::vector<u8>> read(std::string_view name) const;
+        [[nodiscard]] stl::result<std::string> read_string(std::string_view name) const;
+        // Write file content; unlike Filesystem::write the parent directories must already exist
+        [[nodiscard]] stl::result<> write(std::string_view name, const std::vector<u8>& content);
+        [[nodiscard]] stl::result<> write(std::string_view name, std::string_view content);
+        // Delete a file or empty directory; a missing entry is not an error
+        [[nodiscard]] stl::result<> remove(std::string_view name);
+        // Create a directory and its parents
+        [[nodiscard]] stl::result<> mkdir(std::string_view name);
+        // List entries of this directory (or a subdirectory), as paths relative to the filesystem root
+        [[nodiscard]] stl::result<PathList> list(std::string_view name = "") const;
+        // Open a subdirectory relative to this one
+        [[nodiscard]] stl::result<Dir> open_dir(std::string_view name) const;
+
+    private:
+        friend class Filesystem;
+
+        Dir() = default;
+
+        std::shared_ptr<const detail::UniqueFd> m_Fd;
+        std::string m_Path;
+        std::filesystem::path m_Absolute;
+        // Shared with the Filesystem that opened this directory
+        std::shared_ptr<detail::LockStripes> m_Locks;
+        std::shared_ptr<detail::NegativeCache> m_Missing;
+
+        [[nodiscard]] stl::result<> write_bytes(std::string_view name, std::span<const u8> content);
+        // Path below the filesystem root of an entry in this directory
+        [[nodiscard]] std::string child_path(std::string_view name) const;
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <string>
+#include <vector>
+
+namespace sap::fs {
+
+    // Space used by a directory tree. Totals cover the whole subtree, including the directories themselves;
+    // symlinks are counted as links and not followed, and a file with several hard links is counted once.
+    struct DiskUsage {
+        // Path relative to the filesystem root
+        std::string path;
+        // Sum of file sizes
+        u64 apparent_bytes = 0;
+        // Sum of allocated blocks in bytes; smaller than apparent_bytes for sparse files
+        u64 allocated_bytes = 0;
+        // Non-directory entries
+        u64 files = 0;
+        // Subdirectories at any depth
+        u64 directories = 0;
+        // Subdirectories with their own totals, sorted by path; only filled down to the requested depth
+        std::vector<DiskUsage> children;
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include "sap_fs/walk.h"
+
+namespace sap::fs {
+
+    // Metadata of one file, symlinks followed
+    struct FileInfo {
+        EntryType type = EntryType::Other;
+        u64 size = 0;
+        // Nanoseconds since epoch
+        i64 mtime_ns = 0;
+        i64 ctime_ns = 0;
+        u64 inode = 0;
+        u64 device = 0;
+        // Permission and type bits as in st_mode
+        u32 mode = 0;
+        u64 nlink = 0;
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include <filesystem>
+
+namespace sap::fs {
+
+    enum class LockMode : u8 {
+        // Any number of shared holders, excluding exclusive ones
+        Shared,
+        Exclusive,
+    };
+
+    enum class LockWait : u8 {
+        // Sleep in the kernel until the lock is granted
+        Block,
+        // Return an unlocked FileLock immediately if the lock is held elsewhere
+        Try,
+    };
+
+    // Advisory whole-file lock held through an open file description (OFD fcntl lock, flock as a fallback).
+    // Visible to other processes and to other FileLocks in this process; released on destruction.
+    class FileLock {
+    public:
+        FileLock() = default;
+        FileLock(FileLock&& other) noexcept;
+        FileLock& operator=(FileLock&& other) noexcept;
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+        ~FileLock();
+
+        // Lock a file by absolute path, creating it if needed
+        [[nodiscard]] static stl::result<FileLock> acquire(const std::filesystem::path& path, LockMode mode, LockWait wait);
+        // False for a default-constructed lock or a Try that found the lock taken
+        [[nodiscard]] bool locked() const { return m_Fd >= 0; }
+        [[nodiscard]] explicit operator bool() const { return locked(); }
+        [[nodiscard]] LockMode mode() const { return m_Mode; }
+        // Release early
+        void unlock();
+
+    private:
+        int m_Fd = -1;
+        LockMode m_Mode = LockMode::Shared;
+    };
+
+} // namespace sap::fs
@@ -4,47 +4,208 @@
 #include <sap_core/timestamp.h>
 #include <sap_core/types.h>
 
+#include "sap_fs/byte_buffer.h"
+#include "sap_fs/dir.h"
+#include "sap_fs/disk_usage.h"
+#include "sap_fs/file_info.h"
+#include "sap_fs/file_lock.h"
+#include "sap_fs/io.h"
+#include "sap_fs/manifest.h"
+#include "sap_fs/mapped_file.h"
+#include "sap_fs/path_list.h"
+#include "sap_fs/rel_path.h"
+#include "sap_fs/walk.h"
+
+#include <chrono>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <vector>
 
+struct stat;
+
 namespace sap::fs {
 
+    namespace detail {
+        class FdCache;
+        class LockStripes;
+        class NegativeCache;
+        class UniqueFd;
+    } // namespace detail
+
+    enum class Concurrency : u8 {
+        // No internal synchronization. Concurrent mutations of the same path race: writes may interleave
+        // truncations and readers may observe partially written files.
+        None,
+        // Mutations serialize per path on striped locks, and write() replaces files atomically (temp file + rename),
+        // so readers never block and never see a partially written file. Different paths proceed in parallel.
+        // The replacement keeps the file's mode (and owner when permitted) but is a new inode: hard links to the
+        // old file keep the old content, and a FileLock held on the old file no longer covers the path.
+        Striped,
+    };
+
+    struct FilesystemOptions {
+        Concurrency concurrency = Concurrency::None;
+        // Descriptors kept open for repeated reads, range reads and stats of the same paths (0 disables)
+        size_t open_file_cache = 64;
+        // How long exists() remembers a missing path (0 disables). Mutations through this Filesystem invalidate it;
+        // files created by other processes show up once the entry expires.
+        std::chrono::milliseconds negative_cache_ttl{0};
+    };
+
+    // Sandboxed file access below a root directory.
+    // Thread safety: const members may be called concurrently from any number of threads. Concurrent mutations
+    // are only well defined with Concurrency::Striped; copies of a Filesystem share its locks.
     class Filesystem {
     public:
         explicit Filesystem(std::filesystem::path root);
+        Filesystem(std::filesystem::path root, const FilesystemOptions& options);
         // Get the root directory
         [[nodiscard]] const std::filesystem::path& root() const { return m_Root; }
+        // Validate a path once for reuse across calls; every method accepts the result in place of a string
+        [[nodiscard]] stl::result<ResolvedPath> resolve(PathRef relative_path) const;
         // Check if a file exists
-        [[nodiscard]] bool exists(std::string_view relative_path) const;
+        [[nodiscard]] bool exists(PathRef relative_path) const;
         // Read file content
-        [[nodiscard]] stl::result<std::vector<u8>> read(std::string_view relative_path) const;
+        [[nodiscard]] stl::result<std::vector<u8>> read(PathRef relative_path) const;
+        [[nodiscard]] stl::result<std::vector<u8>> read(PathRef relative_path, const ReadOptions& options) const;
+        // Read file content into memory from resource (e.g. a per-frame monotonic arena)
+        [[nodiscard]] stl::result<std::pmr::vector<u8>> read(PathRef relative_path, std::pmr::memory_resource* resource,
+                                                             const ReadOptions& options = {}) const;
+        // Read file content into a buffer drawn from pool; hand it back with pool.release() when done
+        [[nodiscard]] stl::result<ByteBuffer> read(PathRef relative_path, BufferPool& pool, const ReadOptions& options = {}) const;
+        // Read length bytes starting at offset, without touching the rest of the file. Shorter at EOF.
+        [[nodiscard]] stl::result<std::vector<u8>> read_range(PathRef relative_path, u64 offset, size_t length) const;
+        // Read several ranges of one file, returned in the order given. Ranges that are adjacent in the file are
+        // coalesced into a single preadv.
+        [[nodiscard]] stl::result<std::vector<std::vector<u8>>> read_ranges(PathRef relative_path,
+                                                                            std::span<const ByteRange> ranges) const;
+        // Memory map a file read-only, applying an access hint to the mapping. DontNeed is rejected here; pass it to
+        // MappedFile::advise once the pages have been used.
+        [[nodiscard]] stl::result<MappedFile> map(PathRef relative_path, AccessHint hint = AccessHint::Normal) const;
+        // Start loading files into the page cache in the background; returns immediately and ignores failures
+        void prefetch(std::span<const std::string> relative_paths) const;
         // Read file as string
-        [[nodiscard]] stl::result<std::string> read_string(std::string_view relative_path) const;
-        // Write file content (creates parent directories if needed)
-        [[nodiscard]] stl::result<> write(std::string_view relative_path, const std::vector<u8>& content);
-        [[nodiscard]] stl::result<> write(std::string_view relative_path, std::string_view content);
+        [[nodiscard]] stl::result<std::string> read_string(PathRef relative_path) const;
+        [[nodiscard]] stl::result<std::pmr::string> read_string(PathRef relative_path, std::pmr::memory_resource* resource) const;
+        // Write file content (creates parent directories if needed). Large files are preallocated up front.
+        [[nodiscard]] stl::result<> write(PathRef relative_path, const std::vector<u8>& content);
+        [[nodiscard]] stl::result<> write(PathRef relative_path, std::string_view content);
+        [[nodiscard]] stl::result<> write(PathRef relative_path, const std::vector<u8>& content, const WriteOptions& options);
+        [[nodiscard]] stl::result<> write(PathRef relative_path, std::string_view content, const WriteOptions& options);
+        // Overwrite bytes in place starting at offset, without truncating; the file is created if missing and grows
+        // if the write extends past its end. Only options.sync applies.
+        [[nodiscard]] stl::result<> write_at(PathRef relative_path, u64 offset, std::span<const u8> content,
+                                             const WriteOptions& options = {});
+        // Apply several in-place writes in order, merging runs of adjacent ranges into one pwritev
+        [[nodiscard]] stl::result<> write_ranges(PathRef relative_path, std::span<const RangeWrite> writes,
+                                                 const WriteOptions& options = {});
+        // Allocate disk blocks for the first size bytes of a file without changing its size (creates it if needed)
+        [[nodiscard]] stl::result<> reserve(PathRef relative_path, size_t size);
+        // Deallocate a byte range; it reads back as zeros and no longer uses disk space
+        [[nodiscard]] stl::result<> punch_hole(PathRef relative_path, size_t offset, size_t length);
+        // Take an advisory lock on a file, creating it (and its parent directories) if needed. Blocking waits sleep
+        // in the kernel until the holder releases; with LockWait::Try an unlocked FileLock means the lock is taken.
+        [[nodiscard]] stl::result<FileLock> lock(PathRef relative_path, LockMode mode = LockMode::Exclusive,
+                                                 LockWait wait = LockWait::Block) const;
         // Delete a file
-        [[nodiscard]] stl::result<> remove(std::string_view relative_path);
+        [[nodiscard]] stl::result<> remove(PathRef relative_path);
+        // Delete a file or a directory with everything below it, emptying subdirectories in parallel. Symlinks are
+        // removed, not followed. Succeeds if the path does not exist.
+        [[nodiscard]] stl::result<> remove_tree(PathRef relative_path);
+        // Copy a file, replacing the destination (creates parent directories if needed). Holes in sparse files are preserved.
+        [[nodiscard]] stl::result<> copy(PathRef from, PathRef to);
+        // Copy a directory tree into to, merging with what is already there; symlinks are copied as links. Files and
+        // subdirectories are copied in parallel. With Concurrency::Striped each destination file is replaced under its
+        // stripe through a temp file and rename, like write().
+        [[nodiscard]] stl::result<> copy_tree(PathRef from, PathRef to, const CopyTreeOptions& options = {});
+        // Move or rename a file or directory, copying across mount points
+        [[nodiscard]] stl::result<> move(PathRef from, PathRef to);
         // Get file size
-        [[nodiscard]] stl::result<size_t> size(std::string_view relative_path) const;
+        [[nodiscard]] stl::result<size_t> size(PathRef relative_path) const;
         // Get file modification time (ms since epoch)
-        [[nodiscard]] stl::result<Timestamp> mtime(std::string_view relative_path) const;
+        [[nodiscard]] stl::result<Timestamp> mtime(PathRef relative_path) const;
         // Set file modification time
-        [[nodiscard]] stl::result<> set_mtime(std::string_view relative_path, Timestamp time);
+        [[nodiscard]] stl::result<> set_mtime(PathRef relative_path, Timestamp time);
+        // All metadata of a file from a single statx (or fstat of a cached descriptor)
+        [[nodiscard]] stl::result<FileInfo> stat(PathRef relative_path) const;
+        // stat() many paths in parallel on the shared thread pool; results are in input order
+        [[nodiscard]] std::vector<stl::result<FileInfo>> stat_many(std::span<const std::string> relative_paths) const;
         // List files in directory (non-recursive)
-        [[nodiscard]] stl::result<std::vector<std::string>> list(std::string_view relative_dir = "") const;
+        [[nodiscard]] stl::result<PathList> list(PathRef relative_dir = "") const;
+        [[nodiscard]] stl::result<PathList> list(PathRef relative_dir, std::pmr::memory_resource* resource) const;
         // List all files recursively
-        [[nodiscard]] stl::result<std::vector<std::string>> list_recursive(std::string_view relative_dir = "") const;
+        [[nodiscard]] stl::result<PathList> list_recursive(PathRef relative_dir = "") const;
+        // List files recursively, filtering and pruning subtrees during the walk
+        [[nodiscard]] stl::result<PathList> list_recursive(PathRef relative_dir, const WalkOptions& options) const;
+        [[nodiscard]] stl::result<PathList> list_recursive(PathRef relative_dir, std::pmr::memory_resource* resource,
+                                                           const WalkOptions& options = {}) const;
+        // Lazily walk a directory tree; for (const auto& entry : fs.walk("dir")) { ... }
+        [[nodiscard]] Walker walk(PathRef relative_dir = "", const WalkOptions& options = {}) const;
+        // Walk a directory tree, calling visitor for every entry until it returns WalkAction::Stop
+        [[nodiscard]] stl::result<> walk(PathRef relative_dir, const WalkVisitor& visitor, const WalkOptions& options = {}) const;
+        // Sizes of a directory tree, statted in parallel. Children are reported for depth levels below the directory
+        // (0 = totals only); totals always cover the whole tree.
+        [[nodiscard]] stl::result<DiskUsage> disk_usage(PathRef relative_dir = "", size_t depth = 0) const;
+        // Snapshot a directory tree (path, size, mtime, inode, optional hash) into a manifest
+        [[nodiscard]] stl::result<Manifest> scan(PathRef relative_dir = "", const ScanOptions& options = {}) const;
+        // Rescan the tree captured by a previous manifest. Directories whose mtime and inode are unchanged are not
+        // re-read and their files are not re-stat'd unless options.stat_files is set.
+        [[nodiscard]] stl::result<Manifest> rescan(const Manifest& previous, const ScanOptions& options = {}) const;
+        // Files added, modified and removed since a snapshot (rescan followed by diff)
+        [[nodiscard]] stl::result<ChangeSet> changes_since(const Manifest& snapshot, const ScanOptions& options = {.stat_files = true}) const;
+        // Save a manifest (creates parent directories if needed)
+        [[nodiscard]] stl::result<> save_manifest(PathRef relative_path, const Manifest& manifest);
+        // Load a manifest written by save_manifest through mmap
+        [[nodiscard]] stl::result<Manifest> load_manifest(PathRef relative_path) const;
+        // Open a directory ("" for the root) as a handle whose operations resolve names relative to it
+        [[nodiscard]] stl::result<Dir> open_dir(PathRef relative_dir) const;
         // Create directory (and parents)
-        [[nodiscard]] stl::result<> mkdir(std::string_view relative_path);
+        [[nodiscard]] stl::result<> mkdir(PathRef relative_path);
         // Get absolute path for a relative path
-        [[nodiscard]] std::filesystem::path absolute(std::string_view relative_path) const;
+        [[nodiscard]] std::filesystem::path absolute(PathRef relative_path) const;
 
     private:
+        friend class Transaction;
+
+        // Writes at least this large are preallocated to limit fragmentation
+        static constexpr size_t s_PreallocateThreshold = 1024 * 1024;
+
         std::filesystem::path m_Root;
+        // Per-path writer locks; null unless Concurrency::Striped
+        std::shared_ptr<detail::LockStripes> m_Locks;
+        // Open descriptors by relative path; null if disabled
+        std::shared_ptr<detail::FdCache> m_Fds;
+        // Paths recently found missing; null if disabled
+        std::shared_ptr<detail::NegativeCache> m_Missing;
+        // Root directory for *at() lookups; null where unavailable
+        std::shared_ptr<const detail::UniqueFd> m_RootFd;
         // Validate path doesn't escape root (prevent path traversal attacks)
-        [[nodiscard]] stl::result<std::filesystem::path> validate_path(std::string_view relative_path) const;
+        [[nodiscard]] stl::result<std::filesystem::path> validate_path(PathRef relative_path) const;
+        // Uncached existence check
+        [[nodiscard]] bool probe(PathRef relative_path) const;
+        // Descriptor for reading, from the cache or freshly opened (and cached); st receives its fstat
+        [[nodiscard]] stl::result<std::shared_ptr<const detail::UniqueFd>> open_read(PathRef relative_path, struct stat& st) const;
+        // Already open descriptor for a path (pinned by a ResolvedPath or cached) that the path still names
+        [[nodiscard]] std::shared_ptr<const detail::UniqueFd> find_open(PathRef relative_path, struct stat& st) const;
+        // Whether the path currently names the file st (an fstat of an open descriptor) describes
+        [[nodiscard]] bool still_names(PathRef relative_path, const struct stat& st) const;
+        // Drop a path's cached descriptor; in-place writes keep it, since the inode stays the same
+        void close_cached(PathRef relative_path) const;
+        // Stat through a cached descriptor if there is one, else by path
+        [[nodiscard]] stl::result<> stat_path(PathRef relative_path, struct stat& st) const;
+        // Read a whole file into a buffer sized through resize (returns the buffer's data pointer)
+        [[nodiscard]] stl::result<> read_into(PathRef relative_path, const ReadOptions& options,
+                                              const std::function<u8*(size_t size)>& resize) const;
+        [[nodiscard]] stl::result<> write_bytes(PathRef relative_path, std::span<const u8> content, const WriteOptions& options);
+        // Create or truncate an absolute path and write content to it
+        [[nodiscard]] static stl::result<> write_file(const std::filesystem::path& abs_path, std::span<const u8> content,
+                                                      const WriteOptions& options);
+        // Create the parent directories of an absolute path
+        [[nodiscard]] static stl::result<> create_parent_directories(const std::filesystem::path& abs_path);
     };
 
 } // namespace sap::fs
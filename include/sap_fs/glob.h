@@ -0,0 +1,54 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs {
+
+    // Set of glob patterns compiled once and matched against '/'-separated relative paths.
+    // Supported syntax: '*' (any run within a segment), '**' (any run across segments),
+    // '?' (one character), '[abc]' / '[a-z]' / '[!abc]' (character classes) and '\' escapes.
+    // Patterns without a '/' are matched against the last path component only.
+    class GlobMatcher {
+    public:
+        GlobMatcher() = default;
+        GlobMatcher(std::initializer_list<std::string_view> patterns);
+        explicit GlobMatcher(const std::vector<std::string>& patterns);
+        // Compile and add a pattern
+        void add(std::string_view pattern);
+        // True if no patterns were added
+        [[nodiscard]] bool empty() const { return m_Patterns.empty(); }
+        // True if any pattern matches the path
+        [[nodiscard]] bool matches(std::string_view path) const;
+
+    private:
+        enum class TokenKind : u8 {
+            Char,
+            Any,
+            Class,
+            Star,
+            GlobStar,
+            GlobStarDir,
+        };
+        struct Token {
+            explicit Token(TokenKind kind, char ch = 0) : kind(kind), ch(ch) {}
+            TokenKind kind;
+            bool negated = false;
+            char ch = 0;
+            // Inclusive ranges for character classes, stored as pairs
+            std::string ranges;
+        };
+        struct Pattern {
+            std::vector<Token> tokens;
+            bool basename_only = false;
+        };
+        std::vector<Pattern> m_Patterns;
+
+        [[nodiscard]] static bool match_pattern(const Pattern& pattern, std::string_view path);
+    };
+
+} // namespace sap::fs
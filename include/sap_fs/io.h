@@ -0,0 +1,72 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <cstddef>
+#include <span>
+
+namespace sap::fs {
+
+    enum class IoMode : u8 {
+        // Through the page cache
+        Buffered,
+        // O_DIRECT with page-aligned bounce buffers, for large sequential transfers that should not evict
+        // the cache. Falls back to Buffered on filesystems that reject O_DIRECT.
+        Direct,
+    };
+
+    // How a file is about to be accessed; forwarded to posix_fadvise for reads and madvise for mappings
+    enum class AccessHint : u8 {
+        Normal,
+        // Read front to back; enables aggressive readahead
+        Sequential,
+        // Scattered access; disables readahead
+        Random,
+        // Start loading the whole file in the background
+        WillNeed,
+        // Drop the cached pages once the data has been consumed
+        DontNeed,
+    };
+
+    struct ReadOptions {
+        IoMode mode = IoMode::Buffered;
+        AccessHint hint = AccessHint::Normal;
+    };
+
+    struct WriteOptions {
+        IoMode mode = IoMode::Buffered;
+        // fdatasync before returning, so the data survives a crash
+        bool sync = false;
+    };
+
+    // How copy_tree() produces each destination file
+    enum class CopyMethod : u8 {
+        // Reflink where supported, then copy_file_range, sendfile and a buffered loop
+        Auto,
+        // Share extents with the source (btrfs, XFS); fails where the filesystem cannot clone
+        Reflink,
+        // Hard link to the source; changes to either path show up in the other
+        Hardlink,
+    };
+
+    struct CopyTreeOptions {
+        CopyMethod method = CopyMethod::Auto;
+        // Give copied files and directories the source's mtime, at set_mtime() (millisecond) precision
+        bool preserve_mtime = false;
+        // Leave destination files alone when their size and mtime() already match the source
+        bool skip_unchanged = false;
+    };
+
+    // Byte range within a file
+    struct ByteRange {
+        u64 offset = 0;
+        size_t length = 0;
+    };
+
+    // Bytes to write at an offset within a file
+    struct RangeWrite {
+        u64 offset = 0;
+        std::span<const u8> data;
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include "sap_fs/mapped_file.h"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs {
+
+    class Filesystem;
+
+    struct ScanOptions {
+        // Store a 64-bit content hash per file (reads every new or changed file)
+        bool hash_contents = false;
+        // On rescan, stat files in unchanged directories so in-place modifications are detected
+        bool stat_files = false;
+    };
+
+    struct ManifestEntry {
+        // Path relative to the filesystem root, '/'-separated
+        std::string_view path;
+        u64 size = 0;
+        i64 mtime_ns = 0;
+        u64 inode = 0;
+        std::optional<u64> hash;
+        bool is_directory = false;
+    };
+
+    // Files that differ between two snapshots, each list sorted with compare_paths
+    struct ChangeSet {
+        std::vector<std::string> added;
+        std::vector<std::string> modified;
+        std::vector<std::string> removed;
+        [[nodiscard]] bool empty() const { return added.empty() && modified.empty() && removed.empty(); }
+    };
+
+    // Compare paths component-wise ('/' sorts before every other byte), i.e. in depth-first order
+    [[nodiscard]] int compare_paths(std::string_view lhs, std::string_view rhs);
+
+    // Compact snapshot of a directory tree. Entries are sorted with compare_paths and the first entry
+    // is the scanned directory itself. Loaded manifests are memory mapped and not copied.
+    class Manifest {
+    public:
+        class Iterator {
+        public:
+            using value_type = ManifestEntry;
+            using difference_type = std::ptrdiff_t;
+            Iterator() = default;
+            Iterator(const Manifest* manifest, size_t index) : m_Manifest(manifest), m_Index(index) {}
+            ManifestEntry operator*() const { return (*m_Manifest)[m_Index]; }
+            Iterator& operator++() {
+                ++m_Index;
+                return *this;
+            }
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++m_Index;
+                return copy;
+            }
+            bool operator==(const Iterator& other) const { return m_Index == other.m_Index; }
+
+        private:
+            const Manifest* m_Manifest = nullptr;
+            size_t m_Index = 0;
+        };
+
+        Manifest() = default;
+        Manifest(Manifest&&) noexcept = default;
+        Manifest& operator=(Manifest&&) noexcept = default;
+
+        // Scanned directory relative to the filesystem root
+        [[nodiscard]] std::string_view root() const;
+        [[nodiscard]] size_t size() const { return m_View.size(); }
+        [[nodiscard]] bool empty() const { return m_View.empty(); }
+        [[nodiscard]] ManifestEntry operator[](size_t index) const;
+        [[nodiscard]] Iterator begin() const { return {this, 0}; }
+        [[nodiscard]] Iterator end() const { return {this, size()}; }
+        // Binary search for an entry by path
+        [[nodiscard]] std::optional<ManifestEntry> find(std::string_view path) const;
+        // Write the binary snapshot to an absolute path (atomically replaced)
+        [[nodiscard]] stl::result<> save(const std::filesystem::path& path) const;
+        // Map a snapshot written by save()
+        [[nodiscard]] static stl::result<Manifest> load(const std::filesystem::path& path);
+
+    private:
+        friend class Filesystem;
+
+        // On-disk record, followed in the file by the path string table
+        struct Record {
+            u64 size;
+            i64 mtime_ns;
+            u64 inode;
+            u64 hash;
+            u32 path_offset;
+            u32 path_length;
+            u32 flags;
+            u32 reserved;
+        };
+        static constexpr u32 s_FlagDirectory = 1u << 0;
+        static constexpr u32 s_FlagHasHash = 1u << 1;
+        struct Scanner;
+
+        std::vector<Record> m_Records;
+        std::vector<char> m_Strings;
+        MappedFile m_Mapping;
+        // Views into either the owned vectors or the mapping
+        std::span<const Record> m_View;
+        std::string_view m_StringView;
+
+        [[nodiscard]] std::string_view path_of(const Record& record) const {
+            return m_StringView.substr(record.path_offset, record.path_length);
+        }
+        [[nodiscard]] size_t lower_bound(std::string_view path) const;
+        friend ChangeSet diff(const Manifest& before, const Manifest& after);
+        // Walk root/relative_dir, reusing unchanged directories from previous when given
+        [[nodiscard]] static stl::result<Manifest> scan(const std::filesystem::path& root, std::string_view relative_dir,
+                                                        const Manifest* previous, const ScanOptions& options);
+    };
+
+    // Files added, modified and removed from before to after, computed by a linear merge of the sorted entries.
+    // Files are modified when their hashes differ (if both snapshots have one), otherwise when size, mtime or inode differ.
+    [[nodiscard]] ChangeSet diff(const Manifest& before, const Manifest& after);
+
+} // namespace sap::fs
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include "sap_fs/io.h"
+
+#include <filesystem>
+#include <span>
+
+namespace sap::fs {
+
+    // Read-only memory mapping of a whole file
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        // Map a file by absolute path
+        [[nodiscard]] static stl::result<MappedFile> open(const std::filesystem::path& path);
+        // Mapped bytes (empty for empty files)
+        [[nodiscard]] const u8* data() const { return m_Data; }
+        [[nodiscard]] size_t size() const { return m_Size; }
+        [[nodiscard]] std::span<const u8> bytes() const { return {m_Data, m_Size}; }
+        // Tell the kernel how the mapping will be accessed (madvise). DontNeed discards the mapped pages, so only
+        // use it after the data has been consumed.
+        void advise(AccessHint hint) const;
+
+    private:
+        const u8* m_Data = nullptr;
+        size_t m_Size = 0;
+
+        void unmap();
+    };
+
+} // namespace sap::fs
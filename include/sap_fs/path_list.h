@@ -0,0 +1,131 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs {
+
+    // Compact list of paths: one contiguous character arena plus a u32 offset/length pair per entry.
+    // Sorting only permutes the offset table; the characters are never moved. Storage comes from a
+    // std::pmr::memory_resource (the default resource unless one is given).
+    class PathList {
+        struct Span {
+            u32 offset;
+            u32 length;
+        };
+
+    public:
+        // The arena is addressed with u32 offsets
+        static constexpr size_t s_MaxBytes = std::numeric_limits<u32>::max();
+
+        class Iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            Iterator() = default;
+            Iterator(const PathList* list, size_t index) : m_List(list), m_Index(index) {}
+            std::string_view operator*() const { return (*m_List)[m_Index]; }
+            std::string_view operator[](difference_type n) const { return (*m_List)[m_Index + n]; }
+            Iterator& operator++() {
+                ++m_Index;
+                return *this;
+            }
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++m_Index;
+                return copy;
+            }
+            Iterator& operator--() {
+                --m_Index;
+                return *this;
+            }
+            Iterator operator--(int) {
+                auto copy = *this;
+                --m_Index;
+                return copy;
+            }
+            Iterator& operator+=(difference_type n) {
+                m_Index += n;
+                return *this;
+            }
+            Iterator& operator-=(difference_type n) {
+                m_Index -= n;
+                return *this;
+            }
+            friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+            friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+            friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) {
+                return static_cast<difference_type>(lhs.m_Index) - static_cast<difference_type>(rhs.m_Index);
+            }
+            bool operator==(const Iterator& other) const { return m_Index == other.m_Index; }
+            auto operator<=>(const Iterator& other) const { return m_Index <=> other.m_Index; }
+
+        private:
+            const PathList* m_List = nullptr;
+            size_t m_Index = 0;
+        };
+
+        PathList() = default;
+        // Allocate the arena and offset table from resource, which must outlive the list
+        explicit PathList(std::pmr::memory_resource* resource) : m_Arena(resource), m_Spans(resource) {}
+
+        [[nodiscard]] size_t size() const { return m_Spans.size(); }
+        [[nodiscard]] bool empty() const { return m_Spans.empty(); }
+        // Total bytes of path data held in the arena
+        [[nodiscard]] size_t bytes() const { return m_Arena.size(); }
+        [[nodiscard]] std::string_view operator[](size_t index) const {
+            const auto& span = m_Spans[index];
+            return {m_Arena.data() + span.offset, span.length};
+        }
+        [[nodiscard]] Iterator begin() const { return {this, 0}; }
+        [[nodiscard]] Iterator end() const { return {this, size()}; }
+
+        void reserve(size_t count, size_t bytes) {
+            m_Spans.reserve(count);
+            m_Arena.reserve(bytes);
+        }
+        // Append a path. Fails (returns false) once the arena would exceed s_MaxBytes.
+        [[nodiscard]] bool push_back(std::string_view path) {
+            if (m_Arena.size() + path.size() > s_MaxBytes) {
+                return false;
+            }
+            m_Spans.push_back({static_cast<u32>(m_Arena.size()), static_cast<u32>(path.size())});
+            m_Arena.insert(m_Arena.end(), path.begin(), path.end());
+            return true;
+        }
+        void clear() {
+            m_Spans.clear();
+            m_Arena.clear();
+        }
+        // Sort in place by permuting the offset table
+        template <typename Compare = std::less<>>
+        void sort(Compare compare = {}) {
+            std::sort(m_Spans.begin(), m_Spans.end(), [&](const Span& lhs, const Span& rhs) { return compare(view(lhs), view(rhs)); });
+        }
+        // Copy out as individually allocated strings (the pre-PathList result type)
+        [[nodiscard]] std::vector<std::string> to_vector() const { return {begin(), end()}; }
+        operator std::vector<std::string>() const { return to_vector(); }
+
+    private:
+        std::pmr::vector<char> m_Arena;
+        std::pmr::vector<Span> m_Spans;
+
+        [[nodiscard]] std::string_view view(const Span& span) const { return {m_Arena.data() + span.offset, span.length}; }
+    };
+
+} // namespace sap::fs
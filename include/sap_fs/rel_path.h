@@ -0,0 +1,119 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include <concepts>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace sap::fs {
+
+    class Filesystem;
+
+    namespace detail {
+
+        class UniqueFd;
+
+        // 64-bit FNV-1a, usable at compile time
+        constexpr u64 fnv1a(std::string_view text) {
+            u64 hash = 0xcbf29ce484222325ULL;
+            for (char c : text) {
+                hash = (hash ^ static_cast<u8>(c)) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+    } // namespace detail
+
+    // Relative path literal checked at compile time: RelPath{"assets/app.toml"} fails to compile if the path is
+    // empty, absolute or has a ".." component. Its hash is computed at compile time too.
+    class RelPath {
+    public:
+        template <size_t N>
+        consteval RelPath(const char (&path)[N]) : m_Path(path, N - 1), m_Hash(detail::fnv1a(m_Path)) {
+            if (!is_lexically_beneath(m_Path)) {
+                throw "RelPath must be non-empty, relative and free of '..' components";
+            }
+        }
+
+        [[nodiscard]] constexpr std::string_view view() const { return m_Path; }
+        [[nodiscard]] constexpr u64 hash() const { return m_Hash; }
+        constexpr operator std::string_view() const { return m_Path; }
+
+        // Non-empty, not absolute and without ".." components, so it cannot climb out of a root lexically
+        static constexpr bool is_lexically_beneath(std::string_view path) {
+            if (path.empty() || path.front() == '/') {
+                return false;
+            }
+            for (size_t begin = 0; begin <= path.size();) {
+                size_t end = path.find('/', begin);
+                if (end == std::string_view::npos) {
+                    end = path.size();
+                }
+                if (path.substr(begin, end - begin) == "..") {
+                    return false;
+                }
+                begin = end + 1;
+            }
+            return true;
+        }
+
+    private:
+        std::string_view m_Path;
+        u64 m_Hash;
+    };
+
+    // Path validated once by Filesystem::resolve() and reusable across calls without validating again. If it named
+    // a regular file at resolve time, that file is kept open and served to reads and stats for as long as the path
+    // still names it. Only valid with the Filesystem (or a copy of it) that resolved it.
+    class ResolvedPath {
+    public:
+        [[nodiscard]] const std::string& relative() const { return m_Relative; }
+        [[nodiscard]] const std::filesystem::path& absolute() const { return m_Absolute; }
+        [[nodiscard]] u64 hash() const { return m_Hash; }
+
+    private:
+        friend class Filesystem;
+
+        std::string m_Relative;
+        std::filesystem::path m_Absolute;
+        u64 m_Hash = 0;
+        // Open descriptor of the file; null if it was not a regular file
+        std::shared_ptr<const detail::UniqueFd> m_Fd;
+    };
+
+    // Path argument taken by Filesystem: a runtime string, a RelPath whose checks and hash are already done, or a
+    // ResolvedPath that skips validation altogether
+    class PathRef {
+    public:
+        PathRef(const char* path) : m_Path(path) {}
+        PathRef(const std::string& path) : m_Path(path) {}
+        PathRef(std::string_view path) : m_Path(path) {}
+        // Anything else that converts to a string_view (std::pmr::string, custom string types); taking it directly
+        // avoids needing two user-defined conversions
+        template <class T>
+            requires std::convertible_to<const T&, std::string_view> && (!std::same_as<std::remove_cvref_t<T>, PathRef>)
+        PathRef(const T& path) : m_Path(std::string_view{path}) {}
+        PathRef(const RelPath& path) : m_Path(path.view()), m_Hash(path.hash()), m_Checked(true) {}
+        PathRef(const ResolvedPath& path) : m_Path(path.relative()), m_Hash(path.hash()), m_Checked(true), m_Resolved(&path) {}
+
+        [[nodiscard]] std::string_view view() const { return m_Path; }
+        operator std::string_view() const { return m_Path; }
+        [[nodiscard]] bool empty() const { return m_Path.empty(); }
+        [[nodiscard]] u64 hash() const { return m_Checked ? m_Hash : detail::fnv1a(m_Path); }
+        [[nodiscard]] bool is_lexically_beneath() const { return m_Checked || RelPath::is_lexically_beneath(m_Path); }
+        // The ResolvedPath this was made from, if any
+        [[nodiscard]] const ResolvedPath* resolved() const { return m_Resolved; }
+
+    private:
+        std::string_view m_Path;
+        u64 m_Hash = 0;
+        // Came from a RelPath or ResolvedPath
+        bool m_Checked = false;
+        const ResolvedPath* m_Resolved = nullptr;
+    };
+
+} // namespace sap::fs
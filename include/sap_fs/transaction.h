@@ -0,0 +1,56 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include "sap_fs/fs.h"
+#include "sap_fs/io.h"
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs {
+
+    // Group of writes and removes applied as a unit. Content is staged in hidden temp files next to each target;
+    // commit() syncs them in parallel, then replaces each file atomically in turn, so readers can see some of the
+    // group applied before the rest. If a step fails, the ones already applied are rolled back. One barrier per
+    // changed directory makes the result durable. Dropping an uncommitted transaction discards it.
+    class Transaction {
+    public:
+        explicit Transaction(Filesystem filesystem);
+        Transaction(Transaction&& other) noexcept = default;
+        Transaction& operator=(Transaction&& other) noexcept;
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+        ~Transaction();
+
+        // Stage new content for a file (creates parent directories now); replaces any earlier staged change to it
+        [[nodiscard]] stl::result<> write(PathRef relative_path, std::span<const u8> content, const WriteOptions& options = {});
+        [[nodiscard]] stl::result<> write(PathRef relative_path, std::string_view content, const WriteOptions& options = {});
+        // Stage a removal; removing a file that does not exist at commit time is not an error
+        [[nodiscard]] stl::result<> remove(PathRef relative_path);
+        // Number of staged changes
+        [[nodiscard]] size_t size() const { return m_Changes.size(); }
+        [[nodiscard]] bool empty() const { return m_Changes.empty(); }
+        // Make all staged changes visible and durable. The transaction is empty afterwards, whether or not it succeeded.
+        // If only the final directory sync fails the changes stay applied, and the error means their durability is unknown.
+        [[nodiscard]] stl::result<> commit();
+        // Drop all staged changes
+        void discard();
+
+    private:
+        struct Change {
+            std::filesystem::path target;
+            // Temp file holding the new content; empty for removes
+            std::filesystem::path staged;
+        };
+
+        Filesystem m_Filesystem;
+        std::vector<Change> m_Changes;
+
+        [[nodiscard]] stl::result<> stage(PathRef relative_path, std::span<const u8> content, const WriteOptions* options);
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <sap_core/types.h>
+
+#include "sap_fs/glob.h"
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace sap::fs {
+
+    class Filesystem;
+
+    // Options for recursive traversal. Paths given to patterns and predicates are relative to the
+    // filesystem root and '/'-separated.
+    struct WalkOptions {
+        // If non-empty, only files matching one of these patterns are reported
+        GlobMatcher include;
+        // Files and directories matching one of these patterns are skipped; excluded directories are never opened
+        GlobMatcher exclude;
+        // Maximum directory depth to descend into (0 = only the starting directory)
+        size_t max_depth = std::numeric_limits<size_t>::max();
+        // Return true to skip a directory's subtree without opening it
+        std::function<bool(std::string_view relative_dir)> prune;
+        // Descend into symlinked directories
+        bool follow_symlinks = false;
+        // Silently skip directories that cannot be opened due to permissions
+        bool skip_permission_denied = false;
+    };
+
+    // Entry type with symlinks resolved; dangling links are Other
+    enum class EntryType : u8 {
+        File,
+        Directory,
+        Other,
+    };
+
+    struct WalkEntry {
+        // Path relative to the filesystem root; only valid until the walk advances
+        std::string_view path;
+        EntryType type = EntryType::Other;
+        // The entry itself is a symlink (only followed into when WalkOptions::follow_symlinks is set)
+        bool is_symlink = false;
+        // 0 for entries directly inside the starting directory
+        size_t depth = 0;
+    };
+
+    enum class WalkAction : u8 {
+        Continue,
+        // Do not descend into the directory just visited
+        SkipSubtree,
+        Stop,
+    };
+
+    using WalkVisitor = std::function<WalkAction(const WalkEntry& entry)>;
+
+    // Lazy pre-order traversal that reads directory streams as it goes, holding one open stream per level
+    // (O(depth) memory). Directories are reported before their contents. Usable as an input range.
+    class Walker {
+    public:
+        class Iterator {
+        public:
+            using value_type = WalkEntry;
+            using difference_type = std::ptrdiff_t;
+            Iterator() = default;
+            explicit Iterator(Walker* walker) : m_Walker(walker), m_Entry(walker->next()) {}
+            const WalkEntry& operator*() const { return *m_Entry; }
+            const WalkEntry* operator->() const { return m_Entry; }
+            Iterator& operator++() {
+                m_Entry = m_Walker->next();
+                return *this;
+            }
+            void operator++(int) { ++*this; }
+            bool operator==(std::default_sentinel_t) const { return m_Entry == nullptr; }
+
+        private:
+            Walker* m_Walker = nullptr;
+            const WalkEntry* m_Entry = nullptr;
+        };
+
+        Walker(Walker&& other) noexcept;
+        Walker& operator=(Walker&& other) noexcept;
+        ~Walker();
+
+        // Advance to the next entry; nullptr once the walk is finished or failed
+        [[nodiscard]] const WalkEntry* next();
+        // Do not descend into the directory most recently returned
+        void skip_subtree();
+        // Error that ended the walk early, if any
+        [[nodiscard]] const std::optional<std::string>& error() const;
+        // Begins the walk; a Walker can only be iterated once
+        [[nodiscard]] Iterator begin() { return Iterator{this}; }
+        [[nodiscard]] std::default_sentinel_t end() const { return {}; }
+
+    private:
+        friend class Filesystem;
+        struct State;
+        std::unique_ptr<State> m_State;
+
+        // Walk absolute_dir, whose path relative to the filesystem root is relative_dir
+        Walker(std::string_view absolute_dir, std::string_view relative_dir, WalkOptions options);
+        // Walker that yields nothing and reports error (if any)
+        explicit Walker(std::optional<std::string> error);
+    };
+
+} // namespace sap::fs
@@ -0,0 +1,106 @@
+#include "sap_fs/byte_buffer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+namespace sap::fs {
+
+    namespace {
+
+        // Smallest class whose buffers hold size bytes
+        size_t class_for_size(size_t size) {
+            size_t shift = std::bit_width(std::max<size_t>(size, 1) - 1);
+            return shift <= BufferPool::s_MinClassShift ? 0 : shift - BufferPool::s_MinClassShift;
+        }
+
+        // Largest class a buffer of this capacity satisfies
+        size_t class_for_capacity(size_t capacity) { return static_cast<size_t>(std::bit_width(capacity)) - 1 - BufferPool::s_MinClassShift; }
+
+    } // namespace
+
+    ByteBuffer::ByteBuffer(ByteBuffer&& other) noexcept :
+        m_Data(std::move(other.m_Data)), m_Size(std::exchange(other.m_Size, 0)), m_Capacity(std::exchange(other.m_Capacity, 0)) {}
+
+    ByteBuffer& ByteBuffer::operator=(ByteBuffer&& other) noexcept {
+        m_Data = std::move(other.m_Data);
+        m_Size = std::exchange(other.m_Size, 0);
+        m_Capacity = std::exchange(other.m_Capacity, 0);
+        return *this;
+    }
+
+    void ByteBuffer::reserve(size_t capacity) {
+        if (capacity <= m_Capacity) {
+            return;
+        }
+        // Default-initialized: no zero fill
+        auto data = std::make_unique_for_overwrite<u8[]>(capacity);
+        if (m_Size > 0) {
+            std::memcpy(data.get(), m_Data.get(), m_Size);
+        }
+        m_Data = std::move(data);
+        m_Capacity = capacity;
+    }
+
+    void ByteBuffer::resize(size_t size) {
+        if (size > m_Capacity) {
+            reserve(std::max(size, m_Capacity * 2));
+        }
+        m_Size = size;
+    }
+
+    ByteBuffer BufferPool::acquire(size_t size) {
+        size_t index = class_for_size(size);
+        ByteBuffer buffer;
+        if (index < s_ClassCount) {
+            {
+                std::lock_guard lock{m_Mutex};
+                auto& bucket = m_Classes[index];
+                if (!bucket.empty()) {
+                    buffer = std::move(bucket.back());
+                    bucket.pop_back();
+                    m_CachedBytes -= buffer.capacity();
+                }
+            }
+            if (buffer.capacity() == 0) {
+                // Round up to the class size so the buffer can come back to the same class
+                buffer.reserve(size_t{1} << (index + s_MinClassShift));
+            }
+        }
+        buffer.resize(size);
+        return buffer;
+    }
+
+    void BufferPool::release(ByteBuffer buffer) {
+        if (buffer.capacity() < (size_t{1} << s_MinClassShift)) {
+            return;
+        }
+        size_t index = class_for_capacity(buffer.capacity());
+        if (index >= s_ClassCount) {
+            return;
+        }
+        buffer.clear();
+        std::lock_guard lock{m_Mutex};
+        if (m_CachedBytes + buffer.capacity() > m_MaxCachedBytes) {
+            return;
+        }
+        m_CachedBytes += buffer.capacity();
+        m_Classes[index].push_back(std::move(buffer));
+    }
+
+    size_t BufferPool::cached_bytes() const {
+        std::lock_guard lock{m_Mutex};
+        return m_CachedBytes;
+    }
+
+    void BufferPool::trim() {
+        std::array<std::vector<ByteBuffer>, s_ClassCount> classes;
+        {
+            std::lock_guard lock{m_Mutex};
+            classes.swap(m_Classes);
+            m_CachedBytes = 0;
+        }
+    }
+
+} // namespace sap::fs
@@ -0,0 +1,195 @@
+#include "copy.h"
+#include "posix.h"
+
+#include <sap_core/types.h>
+
+#include <algorithm>
+#include <optional>
+
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        // Errors that mean "this mechanism is not available here", as opposed to an I/O failure
+        bool is_unsupported(int err) { return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == ENOTTY; }
+
+        // Copy [offset, offset + length) to the same offset in out
+        stl::result<> copy_range(int in, int out, off_t offset, size_t length) {
+            off_t in_offset = offset;
+            off_t out_offset = offset;
+            while (length > 0) {
+                ssize_t n = ::copy_file_range(in, &in_offset, out, &out_offset, length, 0);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if (is_unsupported(errno))
+                        break;
+                    return stl::make_error("Failed to copy file: {}", errno_message());
+                }
+                if (n == 0)
+                    return stl::success;
+                length -= static_cast<size_t>(n);
+            }
+            offset = in_offset;
+            u8 buffer[128 * 1024];
+            while (length > 0) {
+                ssize_t n = pread_full(in, buffer, std::min(length, sizeof(buffer)), offset);
+                if (n < 0) {
+                    return stl::make_error("Failed to read file: {}", errno_message());
+                }
+                if (n == 0)
+                    return stl::success;
+                if (!pwrite_all(out, buffer, static_cast<size_t>(n), offset)) {
+                    return stl::make_error("Failed to write file: {}", errno_message());
+                }
+                offset += n;
+                length -= static_cast<size_t>(n);
+            }
+            return stl::success;
+        }
+
+        // Copy only the data extents of a sparse file; holes stay unallocated in out.
+        // Returns nullopt if the filesystem cannot report holes.
+        std::optional<stl::result<>> copy_sparse(int in, int out, size_t size) {
+            off_t end = static_cast<off_t>(size);
+            off_t data = 0;
+            while (data < end) {
+                data = ::lseek(in, data, SEEK_DATA);
+                if (data < 0) {
+                    if (errno == ENXIO)
+                        break;
+                    if (errno == EINVAL)
+                        return std::nullopt;
+                    return stl::make_error("Failed to seek file: {}", errno_message());
+                }
+                off_t hole = ::lseek(in, data, SEEK_HOLE);
+                if (hole < 0) {
+                    return stl::make_error("Failed to seek file: {}", errno_message());
+                }
+                hole = std::min(hole, end);
+                if (auto result = copy_range(in, out, data, static_cast<size_t>(hole - data)); !result) {
+                    return result;
+                }
+                data = hole;
+            }
+            // Extends out over any trailing hole
+            if (::ftruncate(out, end) != 0) {
+                return stl::make_error("Failed to set file size: {}", errno_message());
+            }
+            return stl::success;
+        }
+
+        stl::result<> copy_buffered(int in, int out) {
+            u8 buffer[128 * 1024];
+            for (;;) {
+                ssize_t n = read_full(in, buffer, sizeof(buffer));
+                if (n < 0) {
+                    return stl::make_error("Failed to read file: {}", errno_message());
+                }
+                if (n == 0)
+                    return stl::success;
+                if (!write_all(out, buffer, static_cast<size_t>(n))) {
+                    return stl::make_error("Failed to write file: {}", errno_message());
+                }
+            }
+        }
+
+    } // namespace
+
+    stl::result<> copy_fd(int in, int out, size_t size) {
+        // Reflink: shares extents on btrfs/XFS, a metadata-only operation
+        if (::ioctl(out, FICLONE, in) == 0) {
+            return stl::success;
+        }
+        struct stat st{};
+        if (::fstat(in, &st) == 0 && static_cast<size_t>(st.st_blocks) * 512 < size) {
+            if (auto result = copy_sparse(in, out, size)) {
+                return *result;
+            }
+        }
+        size_t copied = 0;
+        while (copied < size) {
+            ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, size - copied, 0);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (copied == 0 && is_unsupported(errno))
+                    break;
+                return stl::make_error("Failed to copy file: {}", errno_message());
+            }
+            if (n == 0)
+                break;
+            copied += static_cast<size_t>(n);
+        }
+        if (copied == 0 && size > 0) {
+            while (copied < size) {
+                ssize_t n = ::sendfile(out, in, nullptr, size - copied);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if (copied == 0 && is_unsupported(errno))
+                        break;
+                    return stl::make_error("Failed to copy file: {}", errno_message());
+                }
+                if (n == 0)
+                    break;
+                copied += static_cast<size_t>(n);
+            }
+        }
+        if (copied > 0) {
+            // The file may have grown since it was stat'ed; pick up any remainder
+            return copy_buffered(in, out);
+        }
+        return copy_buffered(in, out);
+    }
+
+    bool preallocate(int fd, size_t size) {
+        if (size > 0 && ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0) {
+            return errno == EOPNOTSUPP || errno == ENOSYS;
+        }
+        return true;
+    }
+
+    stl::result<> copy_file(const std::filesystem::path& from, const std::filesystem::path& to, bool staged) {
+        UniqueFd in{::open(from.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (!in) {
+            return stl::make_error("Failed to open file: {}: {}", from.string(), errno_message());
+        }
+        struct stat st{};
+        if (::fstat(in.get(), &st) != 0) {
+            return stl::make_error("Failed to stat file: {}", errno_message());
+        }
+        if (!S_ISREG(st.st_mode)) {
+            return stl::make_error("Not a regular file: {}", from.string());
+        }
+        struct stat to_st{};
+        bool replacing = ::stat(to.c_str(), &to_st) == 0;
+        if (replacing && to_st.st_dev == st.st_dev && to_st.st_ino == st.st_ino) {
+            return stl::make_error("Source and destination are the same file: {}", from.string());
+        }
+        auto out_path = staged ? temp_path_for(to) : to;
+        UniqueFd out{::open(out_path.c_str(), O_WRONLY | O_CREAT | (staged ? O_EXCL : O_TRUNC) | O_CLOEXEC, st.st_mode & 07777)};
+        if (!out) {
+            return stl::make_error("Failed to open file for writing: {}: {}", to.string(), errno_message());
+        }
+        auto result = copy_fd(in.get(), out.get(), static_cast<size_t>(st.st_size));
+        if (!staged) {
+            return result;
+        }
+        if (result && replacing && !keep_attributes(out.get(), to_st)) {
+            result = stl::make_error("Failed to set file mode: {}", errno_message());
+        }
+        if (result && ::rename(out_path.c_str(), to.c_str()) != 0) {
+            result = stl::make_error("Failed to replace file: {}", errno_message());
+        }
+        if (!result) {
+            ::unlink(out_path.c_str());
+        }
+        return result;
+    }
+
+} // namespace sap::fs::detail
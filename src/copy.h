@@ -0,0 +1,20 @@
+#pragma once
+
+#include <sap_core/result.h>
+
+#include <filesystem>
+
+namespace sap::fs::detail {
+
+    // Copy size bytes from in to out, preferring a reflink, then copy_file_range, then sendfile,
+    // then a buffered read/write loop. Sparse sources only have their data extents copied.
+    // Both descriptors must be positioned at offset 0 and out must be empty.
+    [[nodiscard]] stl::result<> copy_fd(int in, int out, size_t size);
+    // Allocate blocks for [0, size) without changing the file size. Best effort: returns false only on real errors.
+    [[nodiscard]] bool preallocate(int fd, size_t size);
+    // Copy a regular file by absolute path, replacing the destination and keeping its permission bits.
+    // With staged set the copy is written to a hidden sibling and renamed over the destination, so readers see
+    // either the old or the new file; an existing destination's mode and owner carry over.
+    [[nodiscard]] stl::result<> copy_file(const std::filesystem::path& from, const std::filesystem::path& to, bool staged);
+
+} // namespace sap::fs::detail
@@ -0,0 +1,283 @@
+#include "copy_tree.h"
+#include "copy.h"
+#include "lock_stripes.h"
+#include "posix.h"
+#include "remove_tree.h"
+#include "thread_pool.h"
+#include "tree_helpers.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        // Timestamp (millisecond) resolution, as reported by Filesystem::mtime and applied by set_mtime
+        long long mtime_ms(const struct stat& st) { return mtime_ns(st) / 1'000'000; }
+
+        bool set_mtime_ms(int fd, const char* name, const struct stat& source) {
+            long long ns = mtime_ms(source) * 1'000'000;
+            timespec times[2] = {{0, UTIME_OMIT}, {static_cast<time_t>(ns / 1'000'000'000), static_cast<long>(ns % 1'000'000'000)}};
+            return name ? ::utimensat(fd, name, times, AT_SYMLINK_NOFOLLOW) == 0 : ::futimens(fd, times) == 0;
+        }
+
+        struct Entry {
+            std::string name;
+            bool is_directory = false;
+        };
+
+        class TreeCopier {
+        public:
+            TreeCopier(const CopyTreeOptions& options, const std::filesystem::path& to_path, LockStripes* stripes)
+                : m_Options(options), m_ToPath(to_path), m_Stripes(stripes) {}
+
+            // Copy everything inside from_fd into to_fd; both stay open
+            void copy_contents(int from_fd, int to_fd, const std::string& dir) {
+                int fd = ::dup(from_fd);
+                DIR* stream = fd < 0 ? nullptr : ::fdopendir(fd);
+                if (!stream) {
+                    if (fd >= 0) {
+                        ::close(fd);
+                    }
+                    fail_errno("Failed to read directory", dir, "");
+                    return;
+                }
+                std::vector<Entry> entries;
+                while (const dirent* entry = ::readdir(stream)) {
+                    std::string_view name = entry->d_name;
+                    if (name == "." || name == "..") {
+                        continue;
+                    }
+                    unsigned char type = entry_type(from_fd, *entry);
+                    if (type == DT_LNK) {
+                        copy_symlink(from_fd, to_fd, dir, entry->d_name);
+                    } else if (type == DT_DIR || type == DT_REG) {
+                        entries.push_back({std::string{name}, type == DT_DIR});
+                    }
+                }
+                ::closedir(stream);
+                ThreadPool::shared().parallel_for(entries.size(), [&](size_t i) {
+                    if (m_Error.failed()) {
+                        return;
+                    }
+                    const char* name = entries[i].name.c_str();
+                    if (entries[i].is_directory) {
+                        copy_directory(from_fd, to_fd, dir, name);
+                    } else {
+                        copy_file(from_fd, to_fd, dir, name);
+                    }
+                });
+            }
+
+            [[nodiscard]] const std::optional<std::string>& error() const { return m_Error.message(); }
+
+        private:
+            const CopyTreeOptions& m_Options;
+            const std::filesystem::path& m_ToPath;
+            // Striped mode: each destination entry is replaced under its path's stripe via a temp file and renameat
+            LockStripes* m_Stripes;
+            FirstError m_Error;
+
+            void copy_directory(int from_fd, int to_fd, const std::string& dir, const char* name) {
+                UniqueFd from{::openat(from_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)};
+                struct stat st{};
+                if (!from || ::fstat(from.get(), &st) != 0) {
+                    fail_errno("Failed to open directory", dir, name);
+                    return;
+                }
+                struct stat existing{};
+                if (::fstatat(to_fd, name, &existing, AT_SYMLINK_NOFOLLOW) == 0 && !S_ISDIR(existing.st_mode)) {
+                    StripeGuard guard{m_Stripes, stripe_path(dir, name)};
+                    if (!make_way(to_fd, dir, name, existing)) {
+                        return;
+                    }
+                }
+                if (::mkdirat(to_fd, name, st.st_mode & 07777) != 0 && errno != EEXIST) {
+                    fail_errno("Failed to create directory", dir, name);
+                    return;
+                }
+                UniqueFd to{::openat(to_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)};
+                if (!to) {
+                    fail_errno("Failed to open directory", dir, name);
+                    return;
+                }
+                copy_contents(from.get(), to.get(), join_path(dir, name));
+                // After the contents, whose creation bumps the directory's mtime
+                if (m_Options.preserve_mtime && !set_mtime_ms(to.get(), nullptr, st)) {
+                    fail_errno("Failed to set mtime", dir, name);
+                }
+            }
+
+            void copy_file(int from_fd, int to_fd, const std::string& dir, const char* name) {
+                UniqueFd in{::openat(from_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)};
+                struct stat st{};
+                if (!in || ::fstat(in.get(), &st) != 0) {
+                    fail_errno("Failed to open file", dir, name);
+                    return;
+                }
+                StripeGuard guard{m_Stripes, stripe_path(dir, name)};
+                struct stat existing{};
+                bool exists = ::fstatat(to_fd, name, &existing, AT_SYMLINK_NOFOLLOW) == 0;
+                bool same_inode = exists && existing.st_dev == st.st_dev && existing.st_ino == st.st_ino;
+                if (m_Options.skip_unchanged && exists && S_ISREG(existing.st_mode) && existing.st_size == st.st_size &&
+                    (same_inode || mtime_ms(existing) == mtime_ms(st))) {
+                    return;
+                }
+                if (same_inode && m_Options.method == CopyMethod::Hardlink) {
+                    // Already the link; renaming a second link over it would be a no-op that strands the temp name
+                    return;
+                }
+                // In place, never write through a hard link to the source or into whatever else is in the way. A staged
+                // copy is renamed over anything but a directory.
+                bool staged = m_Stripes != nullptr;
+                if (exists && (S_ISDIR(existing.st_mode) ||
+                               (!staged && (same_inode || !S_ISREG(existing.st_mode) || m_Options.method == CopyMethod::Hardlink))) &&
+                    !make_way(to_fd, dir, name, existing)) {
+                    return;
+                }
+                auto target = staged ? temp_path_for(name).native() : std::string{name};
+                bool copied = m_Options.method == CopyMethod::Hardlink ? link_file(from_fd, to_fd, dir, name, target.c_str())
+                                                                      : write_file(in.get(), st, to_fd, dir, name, target.c_str(), staged);
+                if (staged) {
+                    if (copied && ::renameat(to_fd, target.c_str(), to_fd, name) != 0) {
+                        fail_errno("Failed to replace", dir, name);
+                        copied = false;
+                    }
+                    if (!copied) {
+                        ::unlinkat(to_fd, target.c_str(), 0);
+                    }
+                }
+            }
+
+            bool link_file(int from_fd, int to_fd, const std::string& dir, const char* name, const char* target) {
+                if (::linkat(from_fd, name, to_fd, target, 0) != 0) {
+                    fail_errno("Failed to link", dir, name);
+                    return false;
+                }
+                return true;
+            }
+
+            bool write_file(int in, const struct stat& st, int to_fd, const std::string& dir, const char* name, const char* target,
+                            bool staged) {
+                // An existing file is only truncated once its new content is certain, so a failed clone leaves it as it was
+                UniqueFd out{::openat(to_fd, target, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, st.st_mode & 07777)};
+                bool created = static_cast<bool>(out);
+                if (!out && !staged && errno == EEXIST) {
+                    out.reset(::openat(to_fd, target, O_WRONLY | O_NOFOLLOW | O_CLOEXEC));
+                }
+                if (!out) {
+                    fail_errno("Failed to open file for writing", dir, name);
+                    return false;
+                }
+                if (m_Options.method == CopyMethod::Reflink) {
+                    if (::ioctl(out.get(), FICLONE, in) != 0) {
+                        fail_errno("Failed to reflink", dir, name);
+                        // Do not leave an empty file behind; a staged temp is removed by the caller
+                        if (created && !staged) {
+                            ::unlinkat(to_fd, target, 0);
+                        }
+                        return false;
+                    }
+                    // The clone only extends the file; drop the tail of a longer previous version
+                    if (!created && ::ftruncate(out.get(), st.st_size) != 0) {
+                        fail_errno("Failed to truncate", dir, name);
+                        return false;
+                    }
+                } else if (!created && ::ftruncate(out.get(), 0) != 0) {
+                    fail_errno("Failed to truncate", dir, name);
+                    return false;
+                } else if (auto result = copy_fd(in, out.get(), static_cast<size_t>(st.st_size)); !result) {
+                    m_Error.set(join_path(dir, name) + ": " + result.error());
+                    return false;
+                }
+                if (m_Options.preserve_mtime && !set_mtime_ms(out.get(), nullptr, st)) {
+                    fail_errno("Failed to set mtime", dir, name);
+                    return false;
+                }
+                return true;
+            }
+
+            void copy_symlink(int from_fd, int to_fd, const std::string& dir, const char* name) {
+                std::string target(PATH_MAX, '\0');
+                ssize_t n = ::readlinkat(from_fd, name, target.data(), target.size());
+                if (n < 0) {
+                    fail_errno("Failed to read symlink", dir, name);
+                    return;
+                }
+                target.resize(static_cast<size_t>(n));
+                StripeGuard guard{m_Stripes, stripe_path(dir, name)};
+                bool staged = m_Stripes != nullptr;
+                struct stat existing{};
+                if (::fstatat(to_fd, name, &existing, AT_SYMLINK_NOFOLLOW) == 0 && (!staged || S_ISDIR(existing.st_mode)) &&
+                    !make_way(to_fd, dir, name, existing)) {
+                    return;
+                }
+                auto link = staged ? temp_path_for(name).native() : std::string{name};
+                if (::symlinkat(target.c_str(), to_fd, link.c_str()) != 0) {
+                    fail_errno("Failed to create symlink", dir, name);
+                    return;
+                }
+                struct stat st{};
+                if (m_Options.preserve_mtime && ::fstatat(from_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    // Best effort: not every filesystem stores symlink timestamps
+                    (void)set_mtime_ms(to_fd, link.c_str(), st);
+                }
+                if (staged && ::renameat(to_fd, link.c_str(), to_fd, name) != 0) {
+                    fail_errno("Failed to replace", dir, name);
+                    ::unlinkat(to_fd, link.c_str(), 0);
+                }
+            }
+
+            // Absolute destination path a stripe is taken on, matching what Filesystem locks for the same file
+            std::filesystem::path stripe_path(const std::string& dir, const char* name) const {
+                return m_Stripes ? (m_ToPath / dir / name).lexically_normal() : std::filesystem::path{};
+            }
+
+            // Remove whatever is at name in the destination, including a whole directory
+            bool make_way(int to_fd, const std::string& dir, const char* name, const struct stat& existing) {
+                if (S_ISDIR(existing.st_mode)) {
+                    if (auto result = remove_tree(to_fd, name); !result) {
+                        m_Error.set(result.error());
+                        return false;
+                    }
+                } else if (::unlinkat(to_fd, name, 0) != 0 && errno != ENOENT) {
+                    fail_errno("Failed to replace", dir, name);
+                    return false;
+                }
+                return true;
+            }
+
+            // Path relative to the copied tree: an empty name is the directory itself, "." at the top
+            void fail_errno(std::string_view what, const std::string& dir, const char* name) {
+                int err = errno;
+                std::string path = *name ? join_path(dir, name) : dir.empty() ? std::string{"."} : dir;
+                m_Error.set(std::string{what} + ": " + path + ": " + errno_message(err));
+            }
+        };
+
+    } // namespace
+
+    stl::result<> copy_tree(int from_fd, int to_fd, const std::filesystem::path& to_path, LockStripes* stripes,
+                            const CopyTreeOptions& options) {
+        TreeCopier copier{options, to_path, stripes};
+        copier.copy_contents(from_fd, to_fd, {});
+        if (copier.error()) {
+            return stl::make_error("{}", *copier.error());
+        }
+        if (options.preserve_mtime) {
+            struct stat st{};
+            if (::fstat(from_fd, &st) != 0 || !set_mtime_ms(to_fd, nullptr, st)) {
+                return stl::make_error("Failed to set mtime: {}", errno_message());
+            }
+        }
+        return stl::success;
+    }
+
+} // namespace sap::fs::detail
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <sap_core/result.h>
+
+#include "sap_fs/io.h"
+
+#include <filesystem>
+
+namespace sap::fs::detail {
+
+    class LockStripes;
+
+    // Copy the contents of the directory open as from_fd into the one open as to_fd (absolute path to_path),
+    // recreating subdirectories and copying symlinks as links. Files and subdirectories of each directory are handled
+    // in parallel on the shared thread pool. With stripes, every destination file and link is replaced under its
+    // path's stripe through a temp file and renameat, as Filesystem::write does. Neither descriptor is closed.
+    [[nodiscard]] stl::result<> copy_tree(int from_fd, int to_fd, const std::filesystem::path& to_path, LockStripes* stripes,
+                                          const CopyTreeOptions& options);
+
+} // namespace sap::fs::detail
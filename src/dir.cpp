@@ -0,0 +1,258 @@
+#include "sap_fs/dir.h"
+#include "sap_fs/rel_path.h"
+#include "file_info.h"
+#include "lock_stripes.h"
+#include "negative_cache.h"
+#include "posix.h"
+#include "tree_helpers.h"
+
+#include <dirent.h>
+
+namespace sap::fs {
+
+    namespace {
+
+        stl::result<> check_name(std::string_view name) {
+            if (!RelPath::is_lexically_beneath(name)) {
+                return stl::make_error("Invalid name: {}", name);
+            }
+            return stl::success;
+        }
+
+        // Directory holding an entry, and the entry's last component
+        struct Parent {
+            // Owns fd when the name has more than one component
+            detail::UniqueFd owned;
+            int fd = -1;
+            std::string leaf;
+        };
+
+        stl::result<Parent> open_parent(int dirfd, std::string_view name) {
+            auto slash = name.rfind('/');
+            if (slash == std::string_view::npos) {
+                return Parent{.owned = {}, .fd = dirfd, .leaf = std::string{name}};
+            }
+            if (slash + 1 == name.size()) {
+                return stl::make_error<Parent>("Invalid name: {}", name);
+            }
+            std::string parent{name.substr(0, slash)};
+            detail::UniqueFd fd{detail::open_beneath(dirfd, parent.c_str(), O_PATH | O_DIRECTORY)};
+            if (!fd) {
+                return stl::make_error<Parent>("Failed to open directory: {}: {}", parent, detail::errno_message());
+            }
+            int raw = fd.get();
+            return Parent{.owned = std::move(fd), .fd = raw, .leaf = std::string{name.substr(slash + 1)}};
+        }
+
+        template <typename Buffer>
+        stl::result<Buffer> read_file(int dirfd, std::string_view name) {
+            if (auto result = check_name(name); !result) {
+                return stl::make_error<Buffer>("{}", result.error());
+            }
+            std::string path{name};
+            detail::UniqueFd fd{detail::open_beneath(dirfd, path.c_str(), O_RDONLY)};
+            if (!fd) {
+                return stl::make_error<Buffer>("Failed to open file: {}: {}", path, detail::errno_message());
+            }
+            struct stat st{};
+            if (::fstat(fd.get(), &st) != 0) {
+                return stl::make_error<Buffer>("Failed to stat file: {}", detail::errno_message());
+            }
+            Buffer content;
+            content.resize(static_cast<size_t>(st.st_size));
+            ssize_t n = detail::pread_full(fd.get(), content.data(), content.size(), 0);
+            if (n < 0) {
+                return stl::make_error<Buffer>("Failed to read file: {}", detail::errno_message());
+            }
+            content.resize(static_cast<size_t>(n));
+            return content;
+        }
+
+    } // namespace
+
+    std::string Dir::child_path(std::string_view name) const { return detail::join_path(m_Path, name); }
+
+    bool Dir::exists(std::string_view name) const { return static_cast<bool>(stat(name)); }
+
+    stl::result<FileInfo> Dir::stat(std::string_view name) const {
+        if (auto result = check_name(name); !result) {
+            return stl::make_error<FileInfo>("{}", result.error());
+        }
+        auto parent = open_parent(m_Fd->get(), name);
+        if (!parent) {
+            return stl::make_error<FileInfo>("{}", parent.error());
+        }
+        struct stat st{};
+        if (::fstatat(parent.value().fd, parent.value().leaf.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return stl::make_error<FileInfo>("Failed to stat file: {}: {}", name, detail::errno_message());
+        }
+        if (S_ISLNK(st.st_mode)) {
+            // Follow the link, but only as far as it stays inside this directory
+            std::string path{name};
+            detail::UniqueFd fd{detail::open_beneath(m_Fd->get(), path.c_str(), O_PATH)};
+            if (!fd || ::fstat(fd.get(), &st) != 0) {
+                return stl::make_error<FileInfo>("Failed to stat file: {}: {}", name, detail::errno_message());
+            }
+        }
+        return detail::to_file_info(st);
+    }
+
+    stl::result<std::vector<u8>> Dir::read(std::string_view name) const { return read_file<std::vector<u8>>(m_Fd->get(), name); }
+
+    stl::result<std::string> Dir::read_string(std::string_view name) const { return read_file<std::string>(m_Fd->get(), name); }
+
+    stl::result<> Dir::write(std::string_view name, const std::vector<u8>& content) { return write_bytes(name, content); }
+
+    stl::result<> Dir::write(std::string_view name, std::string_view content) {
+        return write_bytes(name, {reinterpret_cast<const u8*>(content.data()), content.size()});
+    }
+
+    stl::result<> Dir::write_bytes(std::string_view name, std::span<const u8> content) {
+        if (auto result = check_name(name); !result) {
+            return result;
+        }
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        if (!m_Locks) {
+            std::string path{name};
+            detail::UniqueFd fd{detail::open_beneath(m_Fd->get(), path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)};
+            if (!fd) {
+                return stl::make_error("Failed to open file for writing: {}: {}", path, detail::errno_message());
+            }
+            if (!detail::write_all(fd.get(), content.data(), content.size())) {
+                return stl::make_error("Failed to write file: {}", detail::errno_message());
+            }
+            return stl::success;
+        }
+        // Striped mode: replace atomically like Filesystem::write, so readers never see a partial file
+        detail::StripeGuard guard{m_Locks.get(), (m_Absolute / name).lexically_normal()};
+        auto parent = open_parent(m_Fd->get(), name);
+        if (!parent) {
+            return stl::make_error("{}", parent.error());
+        }
+        int dirfd = parent.value().fd;
+        const auto& leaf = parent.value().leaf;
+        auto temp = detail::temp_path_for(leaf).native();
+        detail::UniqueFd fd{::openat(dirfd, temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666)};
+        if (!fd) {
+            return stl::make_error("Failed to open file for writing: {}: {}", name, detail::errno_message());
+        }
+        // Like Filesystem::write, the replacement keeps the file's mode and, where permitted, its owner
+        struct stat existing{};
+        bool replacing = ::fstatat(dirfd, leaf.c_str(), &existing, 0) == 0;
+        bool metadata = !replacing || detail::keep_attributes(fd.get(), existing);
+        if (!metadata || !detail::write_all(fd.get(), content.data(), content.size()) ||
+            ::renameat(dirfd, temp.c_str(), dirfd, leaf.c_str()) != 0) {
+            auto message = detail::errno_message();
+            ::unlinkat(dirfd, temp.c_str(), 0);
+            return stl::make_error("Failed to write file: {}", message);
+        }
+        return stl::success;
+    }
+
+    stl::result<> Dir::remove(std::string_view name) {
+        if (auto result = check_name(name); !result) {
+            return result;
+        }
+        detail::StripeGuard guard{m_Locks.get(), (m_Absolute / name).lexically_normal()};
+        auto parent = open_parent(m_Fd->get(), name);
+        if (!parent) {
+            return stl::make_error("{}", parent.error());
+        }
+        int dirfd = parent.value().fd;
+        const char* leaf = parent.value().leaf.c_str();
+        if (::unlinkat(dirfd, leaf, 0) == 0 || errno == ENOENT) {
+            return stl::success;
+        }
+        if ((errno == EISDIR || errno == EPERM) && ::unlinkat(dirfd, leaf, AT_REMOVEDIR) == 0) {
+            return stl::success;
+        }
+        return stl::make_error("Failed to remove file: {}", detail::errno_message());
+    }
+
+    stl::result<> Dir::mkdir(std::string_view name) {
+        if (auto result = check_name(name); !result) {
+            return result;
+        }
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        // One component at a time, each opened beneath the previous, so an existing symlink cannot redirect creation
+        int dirfd = m_Fd->get();
+        detail::UniqueFd current;
+        for (size_t begin = 0; begin < name.size();) {
+            size_t end = std::min(name.find('/', begin), name.size());
+            std::string component{name.substr(begin, end - begin)};
+            begin = end + 1;
+            if (component.empty() || component == ".") {
+                continue;
+            }
+            if (::mkdirat(dirfd, component.c_str(), 0777) != 0 && errno != EEXIST) {
+                return stl::make_error("Failed to create directory: {}: {}", name, detail::errno_message());
+            }
+            detail::UniqueFd next{detail::open_beneath(dirfd, component.c_str(), O_PATH | O_DIRECTORY)};
+            if (!next) {
+                return stl::make_error("Failed to create directory: {}: {}", name, detail::errno_message());
+            }
+            current = std::move(next);
+            dirfd = current.get();
+        }
+        return stl::success;
+    }
+
+    stl::result<PathList> Dir::list(std::string_view name) const {
+        if (!name.empty()) {
+            if (auto result = check_name(name); !result) {
+                return stl::make_error<PathList>("{}", result.error());
+            }
+        }
+        std::string path{name.empty() ? "." : name};
+        detail::UniqueFd fd{detail::open_beneath(m_Fd->get(), path.c_str(), O_RDONLY | O_DIRECTORY)};
+        if (!fd) {
+            if (errno == ENOENT) {
+                return PathList{};
+            }
+            return stl::make_error<PathList>("Failed to list directory: {}: {}", path, detail::errno_message());
+        }
+        DIR* dir = ::fdopendir(fd.get());
+        if (!dir) {
+            return stl::make_error<PathList>("Failed to list directory: {}", detail::errno_message());
+        }
+        fd.release();
+        std::string prefix = name.empty() ? m_Path : child_path(name);
+        if (!prefix.empty()) {
+            prefix += '/';
+        }
+        PathList entries;
+        std::string entry_path;
+        while (const dirent* entry = ::readdir(dir)) {
+            std::string_view entry_name = entry->d_name;
+            if (entry_name == "." || entry_name == "..") {
+                continue;
+            }
+            entry_path.assign(prefix).append(entry_name);
+            if (!entries.push_back(entry_path)) {
+                ::closedir(dir);
+                return stl::make_error<PathList>("Listing exceeds {} bytes", PathList::s_MaxBytes);
+            }
+        }
+        ::closedir(dir);
+        return entries;
+    }
+
+    stl::result<Dir> Dir::open_dir(std::string_view name) const {
+        if (auto result = check_name(name); !result) {
+            return stl::make_error<Dir>("{}", result.error());
+        }
+        std::string path{name};
+        detail::UniqueFd fd{detail::open_beneath(m_Fd->get(), path.c_str(), O_RDONLY | O_DIRECTORY)};
+        if (!fd) {
+            return stl::make_error<Dir>("Failed to open directory: {}: {}", path, detail::errno_message());
+        }
+        Dir dir;
+        dir.m_Fd = std::make_shared<const detail::UniqueFd>(fd.release());
+        dir.m_Path = child_path(name);
+        dir.m_Absolute = (m_Absolute / name).lexically_normal();
+        dir.m_Locks = m_Locks;
+        dir.m_Missing = m_Missing;
+        return dir;
+    }
+
+} // namespace sap::fs
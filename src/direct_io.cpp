@@ -0,0 +1,153 @@
+#include "direct_io.h"
+#include "copy.h"
+#include "posix.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        // Covers the logical block size of every device we care about
+        constexpr size_t s_Alignment = 4096;
+        constexpr size_t s_BufferSize = 1024 * 1024;
+        constexpr size_t s_MaxPooledBuffers = 16;
+
+        struct FreeDeleter {
+            void operator()(u8* ptr) const { std::free(ptr); }
+        };
+        using AlignedBuffer = std::unique_ptr<u8, FreeDeleter>;
+
+        // Process-wide pool of page-aligned transfer buffers
+        class AlignedBufferPool {
+        public:
+            AlignedBuffer acquire() {
+                {
+                    std::lock_guard lock{m_Mutex};
+                    if (!m_Free.empty()) {
+                        auto buffer = std::move(m_Free.back());
+                        m_Free.pop_back();
+                        return buffer;
+                    }
+                }
+                return AlignedBuffer{static_cast<u8*>(std::aligned_alloc(s_Alignment, s_BufferSize))};
+            }
+
+            void release(AlignedBuffer buffer) {
+                std::lock_guard lock{m_Mutex};
+                if (buffer && m_Free.size() < s_MaxPooledBuffers) {
+                    m_Free.push_back(std::move(buffer));
+                }
+            }
+
+        private:
+            std::mutex m_Mutex;
+            std::vector<AlignedBuffer> m_Free;
+        };
+
+        AlignedBufferPool& buffer_pool() {
+            static AlignedBufferPool pool;
+            return pool;
+        }
+
+        // Borrowed pool buffer returned on destruction
+        class PooledBuffer {
+        public:
+            PooledBuffer() : m_Buffer(buffer_pool().acquire()) {}
+            ~PooledBuffer() { buffer_pool().release(std::move(m_Buffer)); }
+            PooledBuffer(const PooledBuffer&) = delete;
+            PooledBuffer& operator=(const PooledBuffer&) = delete;
+            [[nodiscard]] u8* get() const { return m_Buffer.get(); }
+
+        private:
+            AlignedBuffer m_Buffer;
+        };
+
+    } // namespace
+
+    std::optional<stl::result<>> read_direct(const std::filesystem::path& path, const ResizeBuffer& resize) {
+        UniqueFd fd{::open(path.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC)};
+        if (!fd) {
+            if (errno == EINVAL)
+                return std::nullopt;
+            return stl::make_error("Failed to open file: {}", path.string());
+        }
+        struct stat st{};
+        if (::fstat(fd.get(), &st) != 0) {
+            return stl::make_error("Failed to stat file: {}", errno_message());
+        }
+        PooledBuffer buffer;
+        if (!buffer.get()) {
+            return stl::make_error("Failed to allocate aligned buffer");
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        u8* content = resize(size);
+        size_t offset = 0;
+        while (offset < size) {
+            // Offsets and lengths stay block aligned; the final read simply comes back short at EOF
+            ssize_t n = ::pread(fd.get(), buffer.get(), s_BufferSize, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EINVAL && offset == 0)
+                    return std::nullopt;
+                return stl::make_error("Failed to read file: {}", errno_message());
+            }
+            if (n == 0)
+                break;
+            size_t take = std::min(static_cast<size_t>(n), size - offset);
+            std::memcpy(content + offset, buffer.get(), take);
+            offset += take;
+        }
+        if (offset != size) {
+            resize(offset);
+        }
+        return stl::success;
+    }
+
+    std::optional<stl::result<>> write_direct(const std::filesystem::path& path, std::span<const u8> content) {
+        UniqueFd fd{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT | O_CLOEXEC, 0666)};
+        if (!fd) {
+            if (errno == EINVAL)
+                return std::nullopt;
+            return stl::make_error("Failed to open file for writing: {}", path.string());
+        }
+        if (!preallocate(fd.get(), content.size())) {
+            return stl::make_error("Failed to allocate file: {}", errno_message());
+        }
+        PooledBuffer buffer;
+        if (!buffer.get()) {
+            return stl::make_error("Failed to allocate aligned buffer");
+        }
+        size_t offset = 0;
+        while (offset < content.size()) {
+            size_t take = std::min(s_BufferSize, content.size() - offset);
+            // Pad the unaligned tail up to a whole block; the file is truncated back afterwards
+            size_t padded = (take + s_Alignment - 1) / s_Alignment * s_Alignment;
+            std::memcpy(buffer.get(), content.data() + offset, take);
+            std::memset(buffer.get() + take, 0, padded - take);
+            ssize_t n = ::pwrite(fd.get(), buffer.get(), padded, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EINVAL && offset == 0)
+                    return std::nullopt;
+                return stl::make_error("Failed to write file: {}", errno_message());
+            }
+            if (static_cast<size_t>(n) != padded) {
+                // A partial block would leave every following offset unaligned
+                return stl::make_error("Failed to write file: short direct write");
+            }
+            offset += take;
+        }
+        if (content.size() % s_Alignment != 0 && ::ftruncate(fd.get(), static_cast<off_t>(content.size())) != 0) {
+            return stl::make_error("Failed to set file size: {}", errno_message());
+        }
+        return stl::success;
+    }
+
+} // namespace sap::fs::detail
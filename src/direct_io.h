@@ -0,0 +1,23 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace sap::fs::detail {
+
+    // Resizes the destination buffer and returns its data pointer
+    using ResizeBuffer = std::function<u8*(size_t size)>;
+
+    // Read a whole file with O_DIRECT into a buffer sized through resize. Returns nullopt if the filesystem
+    // rejects O_DIRECT.
+    [[nodiscard]] std::optional<stl::result<>> read_direct(const std::filesystem::path& path, const ResizeBuffer& resize);
+    // Replace a file's content with O_DIRECT. Returns nullopt if the filesystem rejects O_DIRECT.
+    [[nodiscard]] std::optional<stl::result<>> write_direct(const std::filesystem::path& path, std::span<const u8> content);
+
+} // namespace sap::fs::detail
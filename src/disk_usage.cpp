@@ -0,0 +1,177 @@
+#include "disk_usage.h"
+#include "posix.h"
+#include "thread_pool.h"
+#include "tree_helpers.h"
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+
+#include <dirent.h>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        struct EntryStat {
+            bool is_directory = false;
+            u64 size = 0;
+            u64 blocks = 0;
+            u64 device = 0;
+            u64 inode = 0;
+            u64 nlink = 1;
+        };
+
+        EntryStat to_entry_stat(const struct stat& st) {
+            return EntryStat{
+                .is_directory = S_ISDIR(st.st_mode),
+                .size = static_cast<u64>(st.st_size),
+                .blocks = static_cast<u64>(st.st_blocks),
+                .device = static_cast<u64>(st.st_dev),
+                .inode = static_cast<u64>(st.st_ino),
+                .nlink = static_cast<u64>(st.st_nlink),
+            };
+        }
+
+        // Stat a directory entry without following symlinks; false with errno set on failure
+        bool stat_entry(int dirfd, const char* name, EntryStat& out) {
+            // Only the fields summed here, so filesystems can skip the rest
+            struct statx stx{};
+            constexpr unsigned mask = STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_INO | STATX_NLINK;
+            if (::statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_SYNC_AS_STAT, mask, &stx) != 0) {
+                return false;
+            }
+            out = EntryStat{
+                .is_directory = S_ISDIR(stx.stx_mode),
+                .size = stx.stx_size,
+                .blocks = stx.stx_blocks,
+                .device = (static_cast<u64>(stx.stx_dev_major) << 32) | stx.stx_dev_minor,
+                .inode = stx.stx_ino,
+                .nlink = stx.stx_nlink,
+            };
+            return true;
+        }
+
+        // Entries that vanish or cannot be read mid-walk are skipped rather than failing the whole scan
+        bool is_skippable(int err) { return err == ENOENT || err == EACCES || err == EPERM; }
+
+        class UsageScanner {
+        public:
+            UsageScanner() : m_Pool(ThreadPool::shared()) {}
+
+            void scan(int dirfd, DiskUsage& node, const EntryStat& self, size_t depth) {
+                add(node, self);
+                DIR* dir = ::fdopendir(dirfd);
+                if (!dir) {
+                    ::close(dirfd);
+                    fail(node.path);
+                    return;
+                }
+                std::vector<std::pair<std::string, EntryStat>> subdirectories;
+                while (const dirent* entry = ::readdir(dir)) {
+                    std::string_view name = entry->d_name;
+                    if (name == "." || name == "..") {
+                        continue;
+                    }
+                    EntryStat st;
+                    if (!stat_entry(::dirfd(dir), entry->d_name, st)) {
+                        if (!is_skippable(errno)) {
+                            fail(node.path);
+                        }
+                        continue;
+                    }
+                    if (st.is_directory) {
+                        subdirectories.emplace_back(std::string{name}, st);
+                    } else if (first_link(st)) {
+                        add(node, st);
+                        ++node.files;
+                    }
+                }
+                std::ranges::sort(subdirectories, {}, &std::pair<std::string, EntryStat>::first);
+
+                std::vector<DiskUsage> children(subdirectories.size());
+                m_Pool.parallel_for(subdirectories.size(), [&](size_t i) {
+                    if (m_Error.failed()) {
+                        return;
+                    }
+                    const auto& [name, st] = subdirectories[i];
+                    auto& child = children[i];
+                    child.path = join_path(node.path, name);
+                    int fd = ::openat(::dirfd(dir), name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                    if (fd < 0) {
+                        // Count the directory itself even if its contents are out of reach
+                        add(child, st);
+                        if (!is_skippable(errno)) {
+                            fail(child.path);
+                        }
+                        return;
+                    }
+                    scan(fd, child, st, depth > 0 ? depth - 1 : 0);
+                });
+                ::closedir(dir);
+
+                for (auto& child : children) {
+                    node.apparent_bytes += child.apparent_bytes;
+                    node.allocated_bytes += child.allocated_bytes;
+                    node.files += child.files;
+                    node.directories += child.directories + 1;
+                }
+                if (depth > 0) {
+                    node.children = std::move(children);
+                }
+            }
+
+            [[nodiscard]] const std::optional<std::string>& error() const { return m_Error.message(); }
+
+        private:
+            struct InodeHash {
+                size_t operator()(const std::pair<u64, u64>& key) const { return std::hash<u64>{}(key.first * 0x9e3779b97f4a7c15ULL ^ key.second); }
+            };
+
+            ThreadPool& m_Pool;
+            std::mutex m_Mutex;
+            // Files with more than one link seen so far
+            std::unordered_set<std::pair<u64, u64>, InodeHash> m_Linked;
+            FirstError m_Error;
+
+            static void add(DiskUsage& node, const EntryStat& st) {
+                node.apparent_bytes += st.size;
+                node.allocated_bytes += st.blocks * 512;
+            }
+
+            bool first_link(const EntryStat& st) {
+                if (st.nlink <= 1) {
+                    return true;
+                }
+                std::lock_guard lock{m_Mutex};
+                return m_Linked.emplace(st.device, st.inode).second;
+            }
+
+            void fail(const std::string& path) {
+                int err = errno;
+                m_Error.set("Failed to scan " + path + ": " + errno_message(err));
+            }
+        };
+
+    } // namespace
+
+    stl::result<DiskUsage> disk_usage(int dirfd, std::string path, size_t depth) {
+        struct stat st{};
+        if (::fstat(dirfd, &st) != 0) {
+            int err = errno;
+            ::close(dirfd);
+            return stl::make_error<DiskUsage>("Failed to stat directory: {}", errno_message(err));
+        }
+        EntryStat self = to_entry_stat(st);
+        UsageScanner scanner;
+        DiskUsage root;
+        root.path = std::move(path);
+        scanner.scan(dirfd, root, self, depth);
+        if (scanner.error()) {
+            return stl::make_error<DiskUsage>("{}", *scanner.error());
+        }
+        return root;
+    }
+
+} // namespace sap::fs::detail
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <sap_core/result.h>
+
+#include "sap_fs/disk_usage.h"
+
+#include <cstddef>
+#include <string>
+
+namespace sap::fs::detail {
+
+    // Measure the directory open as dirfd (takes ownership), whose path below the root is path, in parallel on the
+    // shared thread pool. Children are kept for depth levels.
+    [[nodiscard]] stl::result<DiskUsage> disk_usage(int dirfd, std::string path, size_t depth);
+
+} // namespace sap::fs::detail
@@ -0,0 +1,52 @@
+#include "fd_cache.h"
+
+namespace sap::fs::detail {
+
+    FdCache::Handle FdCache::find(const PathRef& key) {
+        std::lock_guard lock{m_Mutex};
+        auto it = m_Index.find(key);
+        if (it == m_Index.end()) {
+            return nullptr;
+        }
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        return it->second->second;
+    }
+
+    void FdCache::insert(const PathRef& key, Handle fd) {
+        std::lock_guard lock{m_Mutex};
+        if (auto it = m_Index.find(key); it != m_Index.end()) {
+            it->second->second = std::move(fd);
+            m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+            return;
+        }
+        m_Entries.emplace_front(std::string{key.view()}, std::move(fd));
+        m_Index.emplace(m_Entries.front().first, m_Entries.begin());
+        if (m_Entries.size() > m_Capacity) {
+            m_Index.erase(m_Entries.back().first);
+            m_Entries.pop_back();
+        }
+    }
+
+    void FdCache::erase(const PathRef& key) {
+        std::lock_guard lock{m_Mutex};
+        if (auto it = m_Index.find(key); it != m_Index.end()) {
+            m_Entries.erase(it->second);
+            m_Index.erase(it);
+        }
+    }
+
+    void FdCache::erase(const PathRef& key, const Handle& fd) {
+        std::lock_guard lock{m_Mutex};
+        if (auto it = m_Index.find(key); it != m_Index.end() && it->second->second == fd) {
+            m_Entries.erase(it->second);
+            m_Index.erase(it);
+        }
+    }
+
+    void FdCache::clear() {
+        std::lock_guard lock{m_Mutex};
+        m_Index.clear();
+        m_Entries.clear();
+    }
+
+} // namespace sap::fs::detail
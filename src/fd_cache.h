@@ -0,0 +1,42 @@
+#pragma once
+
+#include "path_key.h"
+#include "posix.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace sap::fs::detail {
+
+    // Bounded LRU of read-only descriptors keyed by relative path, so hot files skip path resolution.
+    // Handles are shared: an evicted descriptor stays open until its last user drops it.
+    class FdCache {
+    public:
+        using Handle = std::shared_ptr<const UniqueFd>;
+
+        explicit FdCache(size_t capacity) : m_Capacity(capacity) {}
+
+        // Cached descriptor for key, marked most recently used. Only the lookup happens under the lock; checking that
+        // the descriptor still matches the path is up to the caller.
+        [[nodiscard]] Handle find(const PathRef& key);
+        void insert(const PathRef& key, Handle fd);
+        void erase(const PathRef& key);
+        // Drop key only if it still maps to fd, so a fresher descriptor inserted meanwhile survives
+        void erase(const PathRef& key, const Handle& fd);
+        void clear();
+
+    private:
+        using Entry = std::pair<std::string, Handle>;
+
+        size_t m_Capacity;
+        std::mutex m_Mutex;
+        // Most recently used first
+        std::list<Entry> m_Entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator, PathKeyHash, PathKeyEqual> m_Index;
+    };
+
+} // namespace sap::fs::detail
@@ -0,0 +1,53 @@
+#include "file_info.h"
+#include "posix.h"
+
+#include <sys/sysmacros.h>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        EntryType entry_type(u32 mode) {
+            if (S_ISREG(mode)) {
+                return EntryType::File;
+            }
+            if (S_ISDIR(mode)) {
+                return EntryType::Directory;
+            }
+            return EntryType::Other;
+        }
+
+    } // namespace
+
+    FileInfo to_file_info(const struct stat& st) {
+        return FileInfo{
+            .type = entry_type(st.st_mode),
+            .size = static_cast<u64>(st.st_size),
+            .mtime_ns = mtime_ns(st),
+            .ctime_ns = static_cast<i64>(st.st_ctim.tv_sec) * 1'000'000'000LL + st.st_ctim.tv_nsec,
+            .inode = static_cast<u64>(st.st_ino),
+            .device = static_cast<u64>(st.st_dev),
+            .mode = static_cast<u32>(st.st_mode),
+            .nlink = static_cast<u64>(st.st_nlink),
+        };
+    }
+
+    stl::result<FileInfo> stat_file(const std::filesystem::path& path) {
+        struct statx stx{};
+        if (::statx(AT_FDCWD, path.c_str(), AT_STATX_SYNC_AS_STAT, STATX_BASIC_STATS, &stx) != 0) {
+            return stl::make_error<FileInfo>("Failed to stat file: {}: {}", path.string(), errno_message());
+        }
+        return FileInfo{
+            .type = entry_type(stx.stx_mode),
+            .size = stx.stx_size,
+            .mtime_ns = static_cast<i64>(stx.stx_mtime.tv_sec) * 1'000'000'000LL + stx.stx_mtime.tv_nsec,
+            .ctime_ns = static_cast<i64>(stx.stx_ctime.tv_sec) * 1'000'000'000LL + stx.stx_ctime.tv_nsec,
+            .inode = stx.stx_ino,
+            // Same encoding as st_dev, so values compare equal across both paths
+            .device = static_cast<u64>(makedev(stx.stx_dev_major, stx.stx_dev_minor)),
+            .mode = stx.stx_mode,
+            .nlink = stx.stx_nlink,
+        };
+    }
+
+} // namespace sap::fs::detail
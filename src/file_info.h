@@ -0,0 +1,17 @@
+#pragma once
+
+#include <sap_core/result.h>
+
+#include "sap_fs/file_info.h"
+
+#include <filesystem>
+
+struct stat;
+
+namespace sap::fs::detail {
+
+    [[nodiscard]] FileInfo to_file_info(const struct stat& st);
+    // One statx (stat where unavailable) of an absolute path
+    [[nodiscard]] stl::result<FileInfo> stat_file(const std::filesystem::path& path);
+
+} // namespace sap::fs::detail
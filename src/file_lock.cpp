@@ -0,0 +1,97 @@
+#include "sap_fs/file_lock.h"
+#include "posix.h"
+
+#include <sys/file.h>
+
+namespace sap::fs {
+
+    namespace {
+
+        enum class LockStatus : u8 {
+            Acquired,
+            Busy,
+            Unsupported,
+            Failed,
+        };
+
+        LockStatus lock_ofd(int fd, LockMode mode, LockWait wait) {
+            struct flock request{};
+            request.l_type = mode == LockMode::Exclusive ? F_WRLCK : F_RDLCK;
+            request.l_whence = SEEK_SET;
+            // l_start = l_len = 0 covers the whole file, including bytes appended later
+            int command = wait == LockWait::Block ? F_OFD_SETLKW : F_OFD_SETLK;
+            while (::fcntl(fd, command, &request) != 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EACCES) {
+                    return LockStatus::Busy;
+                }
+                return errno == EINVAL ? LockStatus::Unsupported : LockStatus::Failed;
+            }
+            return LockStatus::Acquired;
+        }
+
+        LockStatus lock_flock(int fd, LockMode mode, LockWait wait) {
+            int operation = mode == LockMode::Exclusive ? LOCK_EX : LOCK_SH;
+            if (wait == LockWait::Try) {
+                operation |= LOCK_NB;
+            }
+            while (::flock(fd, operation) != 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EWOULDBLOCK ? LockStatus::Busy : LockStatus::Failed;
+            }
+            return LockStatus::Acquired;
+        }
+
+    } // namespace
+
+    FileLock::FileLock(FileLock&& other) noexcept : m_Fd(std::exchange(other.m_Fd, -1)), m_Mode(other.m_Mode) {}
+
+    FileLock& FileLock::operator=(FileLock&& other) noexcept {
+        if (this != &other) {
+            unlock();
+            m_Fd = std::exchange(other.m_Fd, -1);
+            m_Mode = other.m_Mode;
+        }
+        return *this;
+    }
+
+    FileLock::~FileLock() { unlock(); }
+
+    void FileLock::unlock() {
+        // Both lock kinds belong to the open file description and are released when it is closed
+        if (m_Fd >= 0) {
+            ::close(m_Fd);
+        }
+        m_Fd = -1;
+    }
+
+    stl::result<FileLock> FileLock::acquire(const std::filesystem::path& path, LockMode mode, LockWait wait) {
+        // A shared fcntl lock needs read access and an exclusive one write access; O_RDWR covers both
+        detail::UniqueFd fd{::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666)};
+        if (!fd) {
+            return stl::make_error<FileLock>("Failed to open lock file: {}: {}", path.string(), detail::errno_message());
+        }
+        auto status = lock_ofd(fd.get(), mode, wait);
+        if (status == LockStatus::Unsupported) {
+            status = lock_flock(fd.get(), mode, wait);
+        }
+        FileLock lock;
+        switch (status) {
+            case LockStatus::Acquired:
+                lock.m_Fd = fd.release();
+                lock.m_Mode = mode;
+                return lock;
+            case LockStatus::Busy:
+                return lock;
+            case LockStatus::Unsupported:
+            case LockStatus::Failed:
+                break;
+        }
+        return stl::make_error<FileLock>("Failed to lock file: {}: {}", path.string(), detail::errno_message());
+    }
+
+} // namespace sap::fs
@@ -1,20 +1,50 @@
 #include "sap_fs/fs.h"
+#include "copy.h"
+#include "copy_tree.h"
+#include "direct_io.h"
+#include "disk_usage.h"
+#include "fd_cache.h"
+#include "file_info.h"
+#include "lock_stripes.h"
+#include "negative_cache.h"
+#include "posix.h"
+#include "range_io.h"
+#include "remove_tree.h"
+#include "thread_pool.h"
+#include <algorithm>
 #include <chrono>
-#include <fstream>
 
 namespace sap::fs {
 
     namespace fs = std::filesystem;
 
-    Filesystem::Filesystem(fs::path root) : m_Root(std::move(root)) {}
+    Filesystem::Filesystem(fs::path root) : Filesystem(std::move(root), FilesystemOptions{}) {}
 
-    stl::result<fs::path> Filesystem::validate_path(std::string_view relative_path) const {
+    Filesystem::Filesystem(fs::path root, const FilesystemOptions& options) : m_Root(std::move(root)) {
+        if (options.concurrency == Concurrency::Striped) {
+            m_Locks = std::make_shared<detail::LockStripes>();
+        }
+        if (options.open_file_cache > 0) {
+            m_Fds = std::make_shared<detail::FdCache>(options.open_file_cache);
+        }
+        if (options.negative_cache_ttl > std::chrono::milliseconds::zero()) {
+            m_Missing = std::make_shared<detail::NegativeCache>(options.negative_cache_ttl);
+        }
+        if (detail::UniqueFd fd{::open(m_Root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC)}) {
+            m_RootFd = std::make_shared<const detail::UniqueFd>(fd.release());
+        }
+    }
+
+    stl::result<fs::path> Filesystem::validate_path(PathRef relative_path) const {
+        if (const auto* resolved = relative_path.resolved()) {
+            return resolved->absolute();
+        }
         // Prevent empty paths
         if (relative_path.empty()) {
             return stl::make_error<fs::path>("Empty path");
         }
         // Build absolute path
-        fs::path abs_path = m_Root / relative_path;
+        fs::path abs_path = m_Root / relative_path.view();
         // Normalize to resolve .. and .
         abs_path = fs::weakly_canonical(abs_path);
         // Check that the result is still under root
@@ -26,74 +56,447 @@ namespace sap::fs {
         return abs_path;
     }
 
-    bool Filesystem::exists(std::string_view relative_path) const {
+    stl::result<> Filesystem::create_parent_directories(const fs::path& abs_path) {
+        if (abs_path.has_parent_path()) {
+            std::error_code ec;
+            fs::create_directories(abs_path.parent_path(), ec);
+            if (ec) {
+                return stl::make_error("Failed to create directories: {}", ec.message());
+            }
+        }
+        return stl::success;
+    }
+
+    stl::result<ResolvedPath> Filesystem::resolve(PathRef relative_path) const {
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error<ResolvedPath>("{}", path_result.error());
+        }
+        ResolvedPath resolved;
+        resolved.m_Relative = std::string{relative_path.view()};
+        resolved.m_Absolute = std::move(path_result.value());
+        resolved.m_Hash = relative_path.hash();
+        // O_NONBLOCK keeps a FIFO from blocking the open; it has no effect on regular files, the only ones kept
+        detail::UniqueFd fd{::open(resolved.m_Absolute.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK)};
+        struct stat st{};
+        if (fd && ::fstat(fd.get(), &st) == 0 && S_ISREG(st.st_mode)) {
+            resolved.m_Fd = std::make_shared<const detail::UniqueFd>(fd.release());
+        }
+        return resolved;
+    }
+
+    bool Filesystem::exists(PathRef relative_path) const {
+        if (!m_Missing) {
+            return probe(relative_path);
+        }
+        if (m_Missing->contains(relative_path)) {
+            return false;
+        }
+        size_t generation = m_Missing->generation();
+        bool found = probe(relative_path);
+        if (!found) {
+            m_Missing->insert(relative_path, generation);
+        }
+        return found;
+    }
+
+    bool Filesystem::probe(PathRef relative_path) const {
+        if (const auto* resolved = relative_path.resolved()) {
+            struct stat st{};
+            return find_open(relative_path, st) || ::stat(resolved->absolute().c_str(), &st) == 0;
+        }
+        // Resolve relative to the root descriptor with the kernel refusing to leave it, instead of canonicalizing
+        if (m_RootFd && relative_path.is_lexically_beneath()) {
+            std::string path{relative_path};
+            detail::UniqueFd fd{detail::open_beneath(m_RootFd->get(), path.c_str(), O_PATH)};
+            if (fd) {
+                return true;
+            }
+            if (errno == ENOENT || errno == ENOTDIR) {
+                return false;
+            }
+            // EXDEV (a symlink that is absolute or leaves the root), unsupported lookups and the like take the
+            // exact path below
+        }
         auto path_result = validate_path(relative_path);
         if (!path_result)
             return false;
         return fs::exists(path_result.value());
     }
 
-    stl::result<std::vector<u8>> Filesystem::read(std::string_view relative_path) const {
+    stl::result<std::vector<u8>> Filesystem::read(PathRef relative_path) const { return read(relative_path, ReadOptions{}); }
+
+    stl::result<std::vector<u8>> Filesystem::read(PathRef relative_path, const ReadOptions& options) const {
+        std::vector<u8> content;
+        auto result = read_into(relative_path, options, [&](size_t size) {
+            content.resize(size);
+            return content.data();
+        });
+        if (!result) {
+            return stl::make_error<std::vector<u8>>("{}", result.error());
+        }
+        return content;
+    }
+
+    stl::result<std::pmr::vector<u8>> Filesystem::read(PathRef relative_path, std::pmr::memory_resource* resource,
+                                                       const ReadOptions& options) const {
+        std::pmr::vector<u8> content{resource};
+        auto result = read_into(relative_path, options, [&](size_t size) {
+            content.resize(size);
+            return content.data();
+        });
+        if (!result) {
+            return stl::make_error<std::pmr::vector<u8>>("{}", result.error());
+        }
+        return content;
+    }
+
+    stl::result<ByteBuffer> Filesystem::read(PathRef relative_path, BufferPool& pool, const ReadOptions& options) const {
+        ByteBuffer content;
+        auto result = read_into(relative_path, options, [&](size_t size) {
+            if (content.capacity() == 0) {
+                content = pool.acquire(size);
+            }
+            content.resize(size);
+            return content.data();
+        });
+        if (!result) {
+            pool.release(std::move(content));
+            return stl::make_error<ByteBuffer>("{}", result.error());
+        }
+        return content;
+    }
+
+    stl::result<std::shared_ptr<const detail::UniqueFd>> Filesystem::open_read(PathRef relative_path, struct stat& st) const {
+        using Handle = std::shared_ptr<const detail::UniqueFd>;
+        if (auto fd = find_open(relative_path, st)) {
+            return fd;
+        }
         auto path_result = validate_path(relative_path);
         if (!path_result) {
-            return stl::make_error<std::vector<u8>>("{}", path_result.error());
+            return stl::make_error<Handle>("{}", path_result.error());
         }
-        std::ifstream file(path_result.value(), std::ios::binary);
-        if (!file) {
-            return stl::make_error<std::vector<u8>>("Failed to open file: {}", path_result.value().string());
+        auto fd = std::make_shared<const detail::UniqueFd>(::open(path_result.value().c_str(), O_RDONLY | O_CLOEXEC));
+        if (!*fd) {
+            return stl::make_error<Handle>("Failed to open file: {}", path_result.value().string());
         }
-        size_t size = fs::file_size(path_result.value());
-        std::vector<u8> content;
-        content.resize(size);
-        if (!file.read(reinterpret_cast<char*>(content.data()), size)) {
-            return stl::make_error<std::vector<u8>>("Failed to read file");
+        if (::fstat(fd->get(), &st) != 0) {
+            return stl::make_error<Handle>("Failed to stat file: {}", detail::errno_message());
+        }
+        if (m_Fds) {
+            m_Fds->insert(relative_path, fd);
+        }
+        return fd;
+    }
+
+    std::shared_ptr<const detail::UniqueFd> Filesystem::find_open(PathRef relative_path, struct stat& st) const {
+        if (const auto* resolved = relative_path.resolved(); resolved && resolved->m_Fd) {
+            if (::fstat(resolved->m_Fd->get(), &st) == 0 && st.st_nlink > 0 && still_names(relative_path, st)) {
+                return resolved->m_Fd;
+            }
+        }
+        if (!m_Fds) {
+            return nullptr;
+        }
+        auto fd = m_Fds->find(relative_path);
+        if (!fd) {
+            return nullptr;
+        }
+        // Outside the cache lock: a hit costs two stats but never waits on other readers' syscalls
+        if (::fstat(fd->get(), &st) == 0 && st.st_nlink > 0 && still_names(relative_path, st)) {
+            return fd;
+        }
+        // Unlinked, or the path now names another file (e.g. an editor renamed the original aside)
+        m_Fds->erase(relative_path, fd);
+        return nullptr;
+    }
+
+    bool Filesystem::still_names(PathRef relative_path, const struct stat& st) const {
+        // Only compared against a descriptor that was validated when opened, so a plain lookup is enough here
+        struct stat current{};
+        bool found = false;
+        if (const auto* resolved = relative_path.resolved()) {
+            found = ::stat(resolved->absolute().c_str(), &current) == 0;
+        } else if (m_RootFd) {
+            std::string path{relative_path};
+            found = ::fstatat(m_RootFd->get(), path.c_str(), &current, 0) == 0;
+        } else {
+            found = ::stat((m_Root / relative_path.view()).c_str(), &current) == 0;
+        }
+        return found && current.st_dev == st.st_dev && current.st_ino == st.st_ino && detail::mtime_ns(current) == detail::mtime_ns(st);
+    }
+
+    void Filesystem::close_cached(PathRef relative_path) const {
+        if (m_Fds) {
+            m_Fds->erase(relative_path);
+        }
+    }
+
+    stl::result<> Filesystem::stat_path(PathRef relative_path, struct stat& st) const {
+        if (find_open(relative_path, st)) {
+            return stl::success;
+        }
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        // Not opened just to stat it: that would block on FIFOs
+        if (::stat(path_result.value().c_str(), &st) != 0) {
+            return stl::make_error("Failed to stat file: {}", detail::errno_message());
+        }
+        return stl::success;
+    }
+
+    stl::result<> Filesystem::read_into(PathRef relative_path, const ReadOptions& options,
+                                        const std::function<u8*(size_t size)>& resize) const {
+        if (options.mode == IoMode::Direct) {
+            auto path_result = validate_path(relative_path);
+            if (!path_result) {
+                return stl::make_error("{}", path_result.error());
+            }
+            if (auto direct = detail::read_direct(path_result.value(), resize)) {
+                return *direct;
+            }
+        }
+        struct stat st{};
+        auto fd_result = open_read(relative_path, st);
+        if (!fd_result) {
+            return stl::make_error("{}", fd_result.error());
+        }
+        int fd = fd_result.value()->get();
+        detail::advise(fd, options.hint);
+        size_t size = static_cast<size_t>(st.st_size);
+        ssize_t n = detail::pread_full(fd, resize(size), size, 0);
+        if (n < 0) {
+            return stl::make_error("Failed to read file");
+        }
+        if (static_cast<size_t>(n) != size) {
+            resize(static_cast<size_t>(n));
+        }
+        if (options.hint == AccessHint::DontNeed) {
+            detail::drop_cache(fd);
+        } else if (options.hint != AccessHint::Normal && m_Fds) {
+            // Cached descriptors are shared between calls; don't let one call's hint stick
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_NORMAL);
+        }
+        return stl::success;
+    }
+
+    stl::result<std::vector<u8>> Filesystem::read_range(PathRef relative_path, u64 offset, size_t length) const {
+        ByteRange range{.offset = offset, .length = length};
+        auto result = read_ranges(relative_path, {&range, 1});
+        if (!result) {
+            return stl::make_error<std::vector<u8>>("{}", result.error());
+        }
+        return std::move(result.value().front());
+    }
+
+    stl::result<std::vector<std::vector<u8>>> Filesystem::read_ranges(PathRef relative_path,
+                                                                      std::span<const ByteRange> ranges) const {
+        struct stat st{};
+        auto fd_result = open_read(relative_path, st);
+        if (!fd_result) {
+            return stl::make_error<std::vector<std::vector<u8>>>("{}", fd_result.error());
+        }
+        return detail::read_ranges(fd_result.value()->get(), ranges);
+    }
+
+    stl::result<std::string> Filesystem::read_string(PathRef relative_path) const {
+        std::string content;
+        auto result = read_into(relative_path, ReadOptions{}, [&](size_t size) {
+            content.resize(size);
+            return reinterpret_cast<u8*>(content.data());
+        });
+        if (!result) {
+            return stl::make_error<std::string>("{}", result.error());
         }
         return content;
     }
 
-    stl::result<std::string> Filesystem::read_string(std::string_view relative_path) const {
-        auto byte_result = read(relative_path);
-        if (!byte_result) {
-            return stl::make_error<std::string>("{}", byte_result.error());
+    stl::result<std::pmr::string> Filesystem::read_string(PathRef relative_path, std::pmr::memory_resource* resource) const {
+        std::pmr::string content{resource};
+        auto result = read_into(relative_path, ReadOptions{}, [&](size_t size) {
+            content.resize(size);
+            return reinterpret_cast<u8*>(content.data());
+        });
+        if (!result) {
+            return stl::make_error<std::pmr::string>("{}", result.error());
         }
-        auto& bytes = byte_result.value();
-        return std::string{bytes.begin(), bytes.end()};
+        return content;
+    }
+
+    stl::result<> Filesystem::write(PathRef relative_path, const std::vector<u8>& content) {
+        return write_bytes(relative_path, content, WriteOptions{});
+    }
+
+    stl::result<> Filesystem::write(PathRef relative_path, std::string_view content) {
+        return write(relative_path, content, WriteOptions{});
     }
 
-    stl::result<> Filesystem::write(std::string_view relative_path, const std::vector<u8>& content) {
+    stl::result<> Filesystem::write(PathRef relative_path, const std::vector<u8>& content, const WriteOptions& options) {
+        return write_bytes(relative_path, content, options);
+    }
+
+    stl::result<> Filesystem::write(PathRef relative_path, std::string_view content, const WriteOptions& options) {
+        return write_bytes(relative_path, {reinterpret_cast<const u8*>(content.data()), content.size()}, options);
+    }
+
+    stl::result<> Filesystem::write_bytes(PathRef relative_path, std::span<const u8> content, const WriteOptions& options) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
         auto path_result = validate_path(relative_path);
         if (!path_result) {
             return stl::make_error("{}", path_result.error());
         }
         auto& abs_path = path_result.value();
-        // Create parent directories
-        if (abs_path.has_parent_path()) {
-            std::error_code ec;
-            fs::create_directories(abs_path.parent_path(), ec);
-            if (ec) {
-                return stl::make_error("Failed to create directories: {}", ec.message());
+        if (auto result = create_parent_directories(abs_path); !result) {
+            return result;
+        }
+        detail::StripeGuard guard{m_Locks.get(), abs_path};
+        close_cached(relative_path);
+        // With striped locking the content is staged in a sibling and renamed over the target, so concurrent
+        // readers see either the old or the new file
+        bool atomic = m_Locks != nullptr;
+        auto target = atomic ? detail::temp_path_for(abs_path) : abs_path;
+        auto result = write_file(target, content, options);
+        if (atomic) {
+            // The replacement is a new inode; carry over the permission bits and, where permitted, the owner
+            if (result && !detail::keep_attributes(target, abs_path)) {
+                result = stl::make_error("Failed to set file mode: {}", detail::errno_message());
+            }
+            if (result && ::rename(target.c_str(), abs_path.c_str()) != 0) {
+                result = stl::make_error("Failed to replace file: {}", detail::errno_message());
+            }
+            if (!result) {
+                ::unlink(target.c_str());
             }
         }
-        std::ofstream file{abs_path, std::ios::binary | std::ios::trunc};
-        if (!file) {
+        return result;
+    }
+
+    stl::result<> Filesystem::write_file(const fs::path& abs_path, std::span<const u8> content, const WriteOptions& options) {
+        if (options.mode == IoMode::Direct) {
+            if (auto direct = detail::write_direct(abs_path, content)) {
+                if (!*direct || !options.sync) {
+                    return *direct;
+                }
+                // O_DIRECT bypasses the cache but not the journal; the new size still needs a sync
+                detail::UniqueFd fd{::open(abs_path.c_str(), O_WRONLY | O_CLOEXEC)};
+                if (!fd || ::fdatasync(fd.get()) != 0) {
+                    return stl::make_error("Failed to sync file: {}", detail::errno_message());
+                }
+                return stl::success;
+            }
+        }
+        detail::UniqueFd fd{::open(abs_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)};
+        if (!fd) {
+            return stl::make_error("Failed to open file for writing: {}", abs_path.string());
+        }
+        // The final size is known, so allocate it in one extent instead of growing block by block
+        if (content.size() >= s_PreallocateThreshold && !detail::preallocate(fd.get(), content.size())) {
+            return stl::make_error("Failed to allocate file: {}", detail::errno_message());
+        }
+        if (!detail::write_all(fd.get(), content.data(), content.size())) {
+            return stl::make_error("Failed to write file: {}", detail::errno_message());
+        }
+        if (options.sync && ::fdatasync(fd.get()) != 0) {
+            return stl::make_error("Failed to sync file: {}", detail::errno_message());
+        }
+        return stl::success;
+    }
+
+    stl::result<> Filesystem::write_at(PathRef relative_path, u64 offset, std::span<const u8> content, const WriteOptions& options) {
+        RangeWrite range{.offset = offset, .data = content};
+        return write_ranges(relative_path, {&range, 1}, options);
+    }
+
+    stl::result<> Filesystem::write_ranges(PathRef relative_path, std::span<const RangeWrite> writes, const WriteOptions& options) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        auto& abs_path = path_result.value();
+        if (auto result = create_parent_directories(abs_path); !result) {
+            return result;
+        }
+        detail::StripeGuard guard{m_Locks.get(), abs_path};
+        detail::UniqueFd fd{::open(abs_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666)};
+        if (!fd) {
+            return stl::make_error("Failed to open file for writing: {}", abs_path.string());
+        }
+        if (!detail::write_ranges(fd.get(), writes)) {
+            return stl::make_error("Failed to write file: {}", detail::errno_message());
+        }
+        if (options.sync && ::fdatasync(fd.get()) != 0) {
+            return stl::make_error("Failed to sync file: {}", detail::errno_message());
+        }
+        return stl::success;
+    }
+
+    stl::result<> Filesystem::reserve(PathRef relative_path, size_t size) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        auto& abs_path = path_result.value();
+        if (auto result = create_parent_directories(abs_path); !result) {
+            return result;
+        }
+        detail::StripeGuard guard{m_Locks.get(), abs_path};
+        detail::UniqueFd fd{::open(abs_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666)};
+        if (!fd) {
             return stl::make_error("Failed to open file for writing: {}", abs_path.string());
         }
-        if (!file.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()))) {
-            return stl::make_error("Failed to write file");
+        // fallocate rejects an empty range; creating the file is all there is to do
+        if (size == 0) {
+            return stl::success;
+        }
+        if (::fallocate(fd.get(), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0) {
+            return stl::make_error("Failed to reserve space: {}", detail::errno_message());
         }
         return stl::success;
     }
 
-    stl::result<> Filesystem::write(std::string_view relative_path, std::string_view content) {
-        std::vector<u8> bytes{content.begin(), content.end()};
-        return write(relative_path, bytes);
+    stl::result<FileLock> Filesystem::lock(PathRef relative_path, LockMode mode, LockWait wait) const {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error<FileLock>("{}", path_result.error());
+        }
+        if (auto result = create_parent_directories(path_result.value()); !result) {
+            return stl::make_error<FileLock>("{}", result.error());
+        }
+        return FileLock::acquire(path_result.value(), mode, wait);
+    }
+
+    stl::result<> Filesystem::punch_hole(PathRef relative_path, size_t offset, size_t length) {
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        detail::StripeGuard guard{m_Locks.get(), path_result.value()};
+        detail::UniqueFd fd{::open(path_result.value().c_str(), O_WRONLY | O_CLOEXEC)};
+        if (!fd) {
+            return stl::make_error("Failed to open file for writing: {}", path_result.value().string());
+        }
+        if (length == 0) {
+            return stl::success;
+        }
+        if (::fallocate(fd.get(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(length)) !=
+            0) {
+            return stl::make_error("Failed to punch hole: {}", detail::errno_message());
+        }
+        return stl::success;
     }
 
-    stl::result<> Filesystem::remove(std::string_view relative_path) {
+    stl::result<> Filesystem::remove(PathRef relative_path) {
         auto path_result = validate_path(relative_path);
         if (!path_result) {
             return stl::make_error("{}", path_result.error());
         }
+        detail::StripeGuard guard{m_Locks.get(), path_result.value()};
+        close_cached(relative_path);
         std::error_code ec;
         if (!fs::remove(path_result.value(), ec)) {
             if (ec) {
@@ -104,35 +507,200 @@ namespace sap::fs {
         return stl::success;
     }
 
-    stl::result<size_t> Filesystem::size(std::string_view relative_path) const {
+    stl::result<> Filesystem::remove_tree(PathRef relative_path) {
+        // Split lexically so a symlink as the last component is removed rather than followed
+        fs::path lexical = fs::path{relative_path.view()}.lexically_normal();
+        if (!lexical.has_filename() && lexical.has_parent_path()) {
+            lexical = lexical.parent_path();
+        }
+        fs::path name = lexical.filename();
+        if (name.empty() || name == "." || name == "..") {
+            return stl::make_error("Refusing to remove the root directory: {}", relative_path.view());
+        }
+        fs::path parent = m_Root;
+        if (lexical.has_parent_path()) {
+            auto path_result = validate_path(lexical.parent_path().generic_string());
+            if (!path_result) {
+                return stl::make_error("{}", path_result.error());
+            }
+            parent = std::move(path_result.value());
+        }
+        detail::UniqueFd parent_fd{::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!parent_fd) {
+            if (errno == ENOENT) {
+                return stl::success;
+            }
+            return stl::make_error("Failed to open directory: {}: {}", parent.string(), detail::errno_message());
+        }
+        detail::StripeGuard guard{m_Locks.get(), parent / name};
+        close_cached(relative_path);
+        return detail::remove_tree(parent_fd.get(), name.c_str());
+    }
+
+    stl::result<MappedFile> Filesystem::map(PathRef relative_path, AccessHint hint) const {
+        // MADV_DONTNEED on a fresh mapping would only discard it; drop pages through MappedFile::advise after use
+        if (hint == AccessHint::DontNeed) {
+            return stl::make_error<MappedFile>("AccessHint::DontNeed cannot be applied when mapping; use MappedFile::advise once done");
+        }
         auto path_result = validate_path(relative_path);
         if (!path_result) {
-            return stl::make_error<size_t>("{}", path_result.error());
+            return stl::make_error<MappedFile>("{}", path_result.error());
+        }
+        auto mapped = MappedFile::open(path_result.value());
+        if (mapped) {
+            mapped.value().advise(hint);
+        }
+        return mapped;
+    }
+
+    void Filesystem::prefetch(std::span<const std::string> relative_paths) const {
+        // Validation also stats, so the whole batch runs on the pool and the caller never blocks on I/O
+        detail::ThreadPool::shared().submit([fs = *this, paths = std::vector<std::string>(relative_paths.begin(), relative_paths.end())] {
+            for (const auto& path : paths) {
+                auto path_result = fs.validate_path(path);
+                if (!path_result)
+                    continue;
+                // Non-blocking open so a FIFO in the batch cannot park a pool worker forever
+                detail::UniqueFd fd{::open(path_result.value().c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)};
+                struct stat st{};
+                if (!fd || ::fstat(fd.get(), &st) != 0 || !S_ISREG(st.st_mode))
+                    continue;
+                // Queues readahead for the whole file without copying anything
+                detail::advise(fd.get(), AccessHint::WillNeed);
+            }
+        });
+    }
+
+    stl::result<> Filesystem::copy(PathRef from, PathRef to) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto from_result = validate_path(from);
+        if (!from_result) {
+            return stl::make_error("{}", from_result.error());
+        }
+        auto to_result = validate_path(to);
+        if (!to_result) {
+            return stl::make_error("{}", to_result.error());
+        }
+        if (auto result = create_parent_directories(to_result.value()); !result) {
+            return result;
+        }
+        detail::StripeGuard guard{m_Locks.get(), to_result.value()};
+        close_cached(to);
+        return detail::copy_file(from_result.value(), to_result.value(), m_Locks != nullptr);
+    }
+
+    stl::result<> Filesystem::copy_tree(PathRef from, PathRef to, const CopyTreeOptions& options) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto from_result = validate_path(from);
+        if (!from_result) {
+            return stl::make_error("{}", from_result.error());
+        }
+        auto to_result = validate_path(to);
+        if (!to_result) {
+            return stl::make_error("{}", to_result.error());
+        }
+        const auto& src = from_result.value();
+        const auto& dst = to_result.value();
+        if (!fs::is_directory(src)) {
+            return stl::make_error("Not a directory");
+        }
+        auto [src_it, dst_it] = std::mismatch(src.begin(), src.end(), dst.begin(), dst.end());
+        if (src_it == src.end()) {
+            return stl::make_error("Cannot copy a directory into itself");
         }
         std::error_code ec;
-        auto sz = fs::file_size(path_result.value(), ec);
+        fs::create_directories(dst, ec);
         if (ec) {
-            return stl::make_error<size_t>("Failed to get file size: {}", ec.message());
+            return stl::make_error("Failed to create directory: {}", ec.message());
         }
-        return static_cast<size_t>(sz);
+        detail::UniqueFd src_fd{::open(src.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!src_fd) {
+            return stl::make_error("Failed to open directory: {}: {}", src.string(), detail::errno_message());
+        }
+        detail::UniqueFd dst_fd{::open(dst.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!dst_fd) {
+            return stl::make_error("Failed to open directory: {}: {}", dst.string(), detail::errno_message());
+        }
+        return detail::copy_tree(src_fd.get(), dst_fd.get(), dst, m_Locks.get(), options);
     }
 
-    stl::result<Timestamp> Filesystem::mtime(std::string_view relative_path) const {
-        auto path_result = validate_path(relative_path);
-        if (!path_result) {
-            return stl::make_error<Timestamp>("{}", path_result.error());
+    stl::result<> Filesystem::move(PathRef from, PathRef to) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto from_result = validate_path(from);
+        if (!from_result) {
+            return stl::make_error("{}", from_result.error());
+        }
+        auto to_result = validate_path(to);
+        if (!to_result) {
+            return stl::make_error("{}", to_result.error());
+        }
+        if (auto result = create_parent_directories(to_result.value()); !result) {
+            return result;
         }
         std::error_code ec;
-        auto ftime = fs::last_write_time(path_result.value(), ec);
+        {
+            detail::StripeGuard guard{m_Locks.get(), from_result.value(), to_result.value()};
+            close_cached(from);
+            close_cached(to);
+            fs::rename(from_result.value(), to_result.value(), ec);
+        }
+        if (ec != std::errc::cross_device_link) {
+            if (ec) {
+                return stl::make_error("Failed to move file: {}", ec.message());
+            }
+            return stl::success;
+        }
+        // Different mount point under root: copy (staged and renamed into place in Striped mode), then remove the source
+        auto copied = fs::is_directory(from_result.value()) ? copy_tree(from, to) : copy(from, to);
+        if (!copied) {
+            return copied;
+        }
+        fs::remove_all(from_result.value(), ec);
         if (ec) {
-            return stl::make_error<Timestamp>("Failed to get mtime: {}", ec.message());
+            return stl::make_error("Failed to remove source after copy: {}", ec.message());
+        }
+        return stl::success;
+    }
+
+    stl::result<size_t> Filesystem::size(PathRef relative_path) const {
+        struct stat st{};
+        if (auto result = stat_path(relative_path, st); !result) {
+            return stl::make_error<size_t>("{}", result.error());
+        }
+        if (S_ISDIR(st.st_mode)) {
+            return stl::make_error<size_t>("Failed to get file size: {}", detail::errno_message(EISDIR));
+        }
+        return static_cast<size_t>(st.st_size);
+    }
+
+    stl::result<Timestamp> Filesystem::mtime(PathRef relative_path) const {
+        struct stat st{};
+        if (auto result = stat_path(relative_path, st); !result) {
+            return stl::make_error<Timestamp>("{}", result.error());
         }
         // Convert to milliseconds since epoch
-        auto sctp = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::file_clock::to_sys(ftime));
-        return sctp.time_since_epoch().count();
+        return static_cast<Timestamp>(detail::mtime_ns(st) / 1'000'000);
+    }
+
+    stl::result<FileInfo> Filesystem::stat(PathRef relative_path) const {
+        struct stat st{};
+        if (find_open(relative_path, st)) {
+            return detail::to_file_info(st);
+        }
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error<FileInfo>("{}", path_result.error());
+        }
+        return detail::stat_file(path_result.value());
+    }
+
+    std::vector<stl::result<FileInfo>> Filesystem::stat_many(std::span<const std::string> relative_paths) const {
+        std::vector<stl::result<FileInfo>> results(relative_paths.size(), stl::make_error<FileInfo>("Not stat'd"));
+        detail::ThreadPool::shared().parallel_for(relative_paths.size(), [&](size_t i) { results[i] = stat(relative_paths[i]); });
+        return results;
     }
 
-    stl::result<> Filesystem::set_mtime(std::string_view relative_path, Timestamp time) {
+    stl::result<> Filesystem::set_mtime(PathRef relative_path, Timestamp time) {
         auto path_result = validate_path(relative_path);
         if (!path_result) {
             return stl::make_error("{}", path_result.error());
@@ -140,6 +708,7 @@ namespace sap::fs {
         // Convert from milliseconds to file_time
         auto sys_time = std::chrono::sys_time<std::chrono::milliseconds>(std::chrono::milliseconds(time));
         auto file_time = std::chrono::file_clock::from_sys(sys_time);
+        detail::StripeGuard guard{m_Locks.get(), path_result.value()};
         std::error_code ec;
         fs::last_write_time(path_result.value(), file_time, ec);
         if (ec) {
@@ -148,76 +717,215 @@ namespace sap::fs {
         return stl::success;
     }
 
-    stl::result<std::vector<std::string>> Filesystem::list(std::string_view relative_dir) const {
+    stl::result<PathList> Filesystem::list(PathRef relative_dir) const {
+        return list(relative_dir, std::pmr::get_default_resource());
+    }
+
+    stl::result<PathList> Filesystem::list(PathRef relative_dir, std::pmr::memory_resource* resource) const {
         fs::path dir_path;
         if (relative_dir.empty()) {
             dir_path = m_Root;
         } else {
             auto path_result = validate_path(relative_dir);
             if (!path_result) {
-                return stl::make_error<std::vector<std::string>>("{}", path_result.error());
+                return stl::make_error<PathList>("{}", path_result.error());
             }
             dir_path = path_result.value();
         }
         if (!fs::exists(dir_path)) {
-            return std::vector<std::string>{};
+            return PathList{resource};
         }
         if (!fs::is_directory(dir_path)) {
-            return stl::make_error<std::vector<std::string>>("Not a directory");
+            return stl::make_error<PathList>("Not a directory");
         }
-        std::vector<std::string> entries;
+        PathList entries{resource};
         std::error_code ec;
         for (const auto& entry : fs::directory_iterator(dir_path, ec)) {
             if (ec)
                 break;
             // Get path relative to root
             auto rel_path = fs::relative(entry.path(), m_Root, ec);
-            if (!ec) {
-                entries.push_back(rel_path.string());
+            if (!ec && !entries.push_back(rel_path.native())) {
+                return stl::make_error<PathList>("Listing exceeds {} bytes", PathList::s_MaxBytes);
             }
         }
         if (ec) {
-            return stl::make_error<std::vector<std::string>>("Failed to list directory: {}", ec.message());
+            return stl::make_error<PathList>("Failed to list directory: {}", ec.message());
+        }
+        return entries;
+    }
+
+    stl::result<PathList> Filesystem::list_recursive(PathRef relative_dir) const {
+        return list_recursive(relative_dir, WalkOptions{});
+    }
+
+    stl::result<PathList> Filesystem::list_recursive(PathRef relative_dir, const WalkOptions& options) const {
+        return list_recursive(relative_dir, std::pmr::get_default_resource(), options);
+    }
+
+    stl::result<PathList> Filesystem::list_recursive(PathRef relative_dir, std::pmr::memory_resource* resource,
+                                                     const WalkOptions& options) const {
+        auto walker = walk(relative_dir, options);
+        PathList entries{resource};
+        while (const auto* entry = walker.next()) {
+            if (entry->type != EntryType::File)
+                continue;
+            if (!entries.push_back(entry->path)) {
+                return stl::make_error<PathList>("Listing exceeds {} bytes", PathList::s_MaxBytes);
+            }
+        }
+        if (walker.error()) {
+            return stl::make_error<PathList>("{}", *walker.error());
         }
         return entries;
     }
 
-    stl::result<std::vector<std::string>> Filesystem::list_recursive(std::string_view relative_dir) const {
+    Walker Filesystem::walk(PathRef relative_dir, const WalkOptions& options) const {
         fs::path dir_path;
         if (relative_dir.empty()) {
             dir_path = m_Root;
         } else {
             auto path_result = validate_path(relative_dir);
             if (!path_result) {
-                return stl::make_error<std::vector<std::string>>("{}", path_result.error());
+                return Walker{path_result.error()};
             }
             dir_path = path_result.value();
         }
-        if (!fs::exists(dir_path)) {
-            return std::vector<std::string>{};
+        std::error_code ec;
+        // Relativize the walk root once; entries below it are joined onto it
+        auto dir_rel = fs::relative(dir_path, m_Root, ec);
+        if (ec) {
+            return Walker{"Failed to list directory: " + ec.message()};
         }
-        if (!fs::is_directory(dir_path)) {
-            return stl::make_error<std::vector<std::string>>("Not a directory");
+        auto rel = dir_rel == "." ? std::string{} : dir_rel.generic_string();
+        return Walker{dir_path.native(), rel, options};
+    }
+
+    stl::result<> Filesystem::walk(PathRef relative_dir, const WalkVisitor& visitor, const WalkOptions& options) const {
+        auto walker = walk(relative_dir, options);
+        while (const auto* entry = walker.next()) {
+            auto action = visitor(*entry);
+            if (action == WalkAction::Stop) {
+                return stl::success;
+            }
+            if (action == WalkAction::SkipSubtree) {
+                walker.skip_subtree();
+            }
         }
-        std::vector<std::string> entries;
-        std::error_code ec;
-        for (const auto& entry : fs::recursive_directory_iterator(dir_path, ec)) {
-            if (ec)
-                break;
-            if (!entry.is_regular_file())
-                continue;
-            auto rel_path = fs::relative(entry.path(), m_Root, ec);
-            if (!ec) {
-                entries.push_back(rel_path.string());
+        if (walker.error()) {
+            return stl::make_error("{}", *walker.error());
+        }
+        return stl::success;
+    }
+
+    stl::result<Manifest> Filesystem::scan(PathRef relative_dir, const ScanOptions& options) const {
+        fs::path dir_path;
+        if (relative_dir.empty()) {
+            dir_path = m_Root;
+        } else {
+            auto path_result = validate_path(relative_dir);
+            if (!path_result) {
+                return stl::make_error<Manifest>("{}", path_result.error());
             }
+            dir_path = path_result.value();
         }
+        std::error_code ec;
+        auto dir_rel = fs::relative(dir_path, m_Root, ec);
         if (ec) {
-            return stl::make_error<std::vector<std::string>>("Failed to list directory: {}", ec.message());
+            return stl::make_error<Manifest>("Failed to scan directory: {}", ec.message());
         }
-        return entries;
+        auto rel = dir_rel == "." ? std::string{} : dir_rel.generic_string();
+        return Manifest::scan(m_Root, rel, nullptr, options);
+    }
+
+    stl::result<Manifest> Filesystem::rescan(const Manifest& previous, const ScanOptions& options) const {
+        if (previous.empty()) {
+            return stl::make_error<Manifest>("Empty manifest");
+        }
+        if (!previous.root().empty()) {
+            auto path_result = validate_path(previous.root());
+            if (!path_result) {
+                return stl::make_error<Manifest>("{}", path_result.error());
+            }
+        }
+        return Manifest::scan(m_Root, previous.root(), &previous, options);
+    }
+
+    stl::result<ChangeSet> Filesystem::changes_since(const Manifest& snapshot, const ScanOptions& options) const {
+        auto current = rescan(snapshot, options);
+        if (!current) {
+            return stl::make_error<ChangeSet>("{}", current.error());
+        }
+        return diff(snapshot, current.value());
+    }
+
+    stl::result<> Filesystem::save_manifest(PathRef relative_path, const Manifest& manifest) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        auto& abs_path = path_result.value();
+        if (auto result = create_parent_directories(abs_path); !result) {
+            return result;
+        }
+        // Saved through a rename, so any cached descriptor would name the old file
+        close_cached(relative_path);
+        return manifest.save(abs_path);
+    }
+
+    stl::result<Manifest> Filesystem::load_manifest(PathRef relative_path) const {
+        auto path_result = validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error<Manifest>("{}", path_result.error());
+        }
+        return Manifest::load(path_result.value());
+    }
+
+    stl::result<DiskUsage> Filesystem::disk_usage(PathRef relative_dir, size_t depth) const {
+        fs::path dir_path = m_Root;
+        if (!relative_dir.empty()) {
+            auto path_result = validate_path(relative_dir);
+            if (!path_result) {
+                return stl::make_error<DiskUsage>("{}", path_result.error());
+            }
+            dir_path = std::move(path_result.value());
+        }
+        detail::UniqueFd fd{::open(dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!fd) {
+            return stl::make_error<DiskUsage>("Failed to open directory: {}: {}", dir_path.string(), detail::errno_message());
+        }
+        auto relative = dir_path.lexically_relative(m_Root).generic_string();
+        return detail::disk_usage(fd.release(), relative == "." ? std::string{} : std::move(relative), depth);
+    }
+
+    stl::result<Dir> Filesystem::open_dir(PathRef relative_dir) const {
+        fs::path dir_path = m_Root;
+        if (!relative_dir.empty()) {
+            auto path_result = validate_path(relative_dir);
+            if (!path_result) {
+                return stl::make_error<Dir>("{}", path_result.error());
+            }
+            dir_path = std::move(path_result.value());
+        }
+        detail::UniqueFd fd{::open(dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!fd) {
+            return stl::make_error<Dir>("Failed to open directory: {}: {}", dir_path.string(), detail::errno_message());
+        }
+        Dir dir;
+        dir.m_Fd = std::make_shared<const detail::UniqueFd>(fd.release());
+        dir.m_Path = dir_path.lexically_relative(m_Root).generic_string();
+        if (dir.m_Path == ".") {
+            dir.m_Path.clear();
+        }
+        dir.m_Absolute = std::move(dir_path);
+        dir.m_Locks = m_Locks;
+        dir.m_Missing = m_Missing;
+        return dir;
     }
 
-    stl::result<> Filesystem::mkdir(std::string_view relative_path) {
+    stl::result<> Filesystem::mkdir(PathRef relative_path) {
+        detail::NegativeCache::Invalidation invalidation{m_Missing.get()};
         auto path_result = validate_path(relative_path);
         if (!path_result) {
             return stl::make_error("{}", path_result.error());
@@ -230,6 +938,6 @@ namespace sap::fs {
         return stl::success;
     }
 
-    fs::path Filesystem::absolute(std::string_view relative_path) const { return m_Root / relative_path; }
+    fs::path Filesystem::absolute(PathRef relative_path) const { return m_Root / relative_path.view(); }
 
 } // namespace sap::fs
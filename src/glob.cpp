@@ -0,0 +1,157 @@
+#include "sap_fs/glob.h"
+#include <algorithm>
+
+namespace sap::fs {
+
+    GlobMatcher::GlobMatcher(std::initializer_list<std::string_view> patterns) {
+        for (auto pattern : patterns) {
+            add(pattern);
+        }
+    }
+
+    GlobMatcher::GlobMatcher(const std::vector<std::string>& patterns) {
+        for (const auto& pattern : patterns) {
+            add(pattern);
+        }
+    }
+
+    void GlobMatcher::add(std::string_view pattern) {
+        Pattern compiled;
+        compiled.basename_only = pattern.find('/') == std::string_view::npos;
+        size_t i = 0;
+        while (i < pattern.size()) {
+            char c = pattern[i];
+            if (c == '*') {
+                if (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+                    i += 2;
+                    // "**/" also matches zero directories
+                    if (i < pattern.size() && pattern[i] == '/') {
+                        compiled.tokens.emplace_back(TokenKind::GlobStarDir);
+                        ++i;
+                    } else {
+                        compiled.tokens.emplace_back(TokenKind::GlobStar);
+                    }
+                } else {
+                    compiled.tokens.emplace_back(TokenKind::Star);
+                    ++i;
+                }
+                continue;
+            }
+            if (c == '?') {
+                compiled.tokens.emplace_back(TokenKind::Any);
+                ++i;
+                continue;
+            }
+            if (c == '[') {
+                size_t j = i + 1;
+                Token token{TokenKind::Class};
+                if (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^')) {
+                    token.negated = true;
+                    ++j;
+                }
+                bool first = true;
+                while (j < pattern.size() && (first || pattern[j] != ']')) {
+                    char lo = pattern[j];
+                    char hi = lo;
+                    if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                        hi = pattern[j + 2];
+                        j += 2;
+                    }
+                    token.ranges.push_back(lo);
+                    token.ranges.push_back(hi);
+                    first = false;
+                    ++j;
+                }
+                if (j < pattern.size()) {
+                    compiled.tokens.push_back(std::move(token));
+                    i = j + 1;
+                    continue;
+                }
+                // Unterminated class, treat '[' literally
+            }
+            if (c == '\\' && i + 1 < pattern.size()) {
+                c = pattern[++i];
+            }
+            compiled.tokens.emplace_back(TokenKind::Char, c);
+            ++i;
+        }
+        m_Patterns.push_back(std::move(compiled));
+    }
+
+    bool GlobMatcher::matches(std::string_view path) const {
+        std::string_view basename = path;
+        if (auto slash = path.rfind('/'); slash != std::string_view::npos) {
+            basename = path.substr(slash + 1);
+        }
+        for (const auto& pattern : m_Patterns) {
+            if (match_pattern(pattern, pattern.basename_only ? basename : path)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool GlobMatcher::match_pattern(const Pattern& pattern, std::string_view path) {
+        // Row-wise DP over tokens: cur[j] is true when the tokens so far match path[0, j)
+        const size_t n = path.size();
+        // Per-thread scratch rows so matching inside a walk does not allocate once capacity has grown
+        thread_local std::vector<u8> cur;
+        thread_local std::vector<u8> next;
+        cur.assign(n + 1, 0);
+        next.assign(n + 1, 0);
+        cur[0] = 1;
+        for (const auto& token : pattern.tokens) {
+            std::fill(next.begin(), next.end(), 0);
+            switch (token.kind) {
+                case TokenKind::Char:
+                    for (size_t j = 0; j < n; ++j) {
+                        next[j + 1] = cur[j] && path[j] == token.ch;
+                    }
+                    break;
+                case TokenKind::Any:
+                    for (size_t j = 0; j < n; ++j) {
+                        next[j + 1] = cur[j] && path[j] != '/';
+                    }
+                    break;
+                case TokenKind::Class:
+                    for (size_t j = 0; j < n; ++j) {
+                        if (!cur[j] || path[j] == '/')
+                            continue;
+                        bool in_class = false;
+                        for (size_t r = 0; r + 1 < token.ranges.size(); r += 2) {
+                            if (path[j] >= token.ranges[r] && path[j] <= token.ranges[r + 1]) {
+                                in_class = true;
+                                break;
+                            }
+                        }
+                        next[j + 1] = in_class != token.negated;
+                    }
+                    break;
+                case TokenKind::Star:
+                    next[0] = cur[0];
+                    for (size_t j = 1; j <= n; ++j) {
+                        next[j] = cur[j] || (next[j - 1] && path[j - 1] != '/');
+                    }
+                    break;
+                case TokenKind::GlobStar:
+                    next[0] = cur[0];
+                    for (size_t j = 1; j <= n; ++j) {
+                        next[j] = cur[j] || next[j - 1];
+                    }
+                    break;
+                case TokenKind::GlobStarDir: {
+                    bool any_before = cur[0];
+                    next[0] = cur[0];
+                    for (size_t j = 1; j <= n; ++j) {
+                        next[j] = cur[j] || (any_before && path[j - 1] == '/');
+                        any_before = any_before || cur[j];
+                    }
+                    break;
+                }
+            }
+            std::swap(cur, next);
+        }
+        return cur[n] != 0;
+    }
+
+} // namespace sap::fs
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sap::fs::detail {
+
+    // Fixed set of mutexes that paths hash onto, so writers serialize per path without a lock per file
+    class LockStripes {
+    public:
+        static constexpr size_t s_StripeCount = 64;
+
+        [[nodiscard]] size_t index(const std::filesystem::path& abs_path) const {
+            return std::hash<std::string_view>{}(abs_path.native()) % s_StripeCount;
+        }
+        [[nodiscard]] std::mutex& at(size_t index) { return m_Stripes[index]; }
+
+    private:
+        std::array<std::mutex, s_StripeCount> m_Stripes;
+    };
+
+    // Holds the stripes for up to two paths, locked in index order so two-path operations cannot deadlock.
+    // A null stripe set makes this a no-op.
+    class StripeGuard {
+    public:
+        StripeGuard(LockStripes* stripes, const std::filesystem::path& path) : StripeGuard(stripes, path, path) {}
+        StripeGuard(LockStripes* stripes, const std::filesystem::path& first, const std::filesystem::path& second) {
+            if (!stripes) {
+                return;
+            }
+            size_t a = stripes->index(first);
+            size_t b = stripes->index(second);
+            if (a > b) {
+                std::swap(a, b);
+            }
+            m_First = std::unique_lock{stripes->at(a)};
+            if (b != a) {
+                m_Second = std::unique_lock{stripes->at(b)};
+            }
+        }
+
+    private:
+        std::unique_lock<std::mutex> m_First;
+        std::unique_lock<std::mutex> m_Second;
+    };
+
+    // Holds the stripes for any number of paths, each distinct stripe locked once in index order
+    class StripeSetGuard {
+    public:
+        StripeSetGuard(LockStripes* stripes, std::span<const std::filesystem::path> paths) {
+            if (!stripes) {
+                return;
+            }
+            std::vector<size_t> indices;
+            indices.reserve(paths.size());
+            for (const auto& path : paths) {
+                indices.push_back(stripes->index(path));
+            }
+            std::ranges::sort(indices);
+            auto [first, last] = std::ranges::unique(indices);
+            indices.erase(first, last);
+            m_Locks.reserve(indices.size());
+            for (size_t index : indices) {
+                m_Locks.emplace_back(stripes->at(index));
+            }
+        }
+
+    private:
+        std::vector<std::unique_lock<std::mutex>> m_Locks;
+    };
+
+} // namespace sap::fs::detail
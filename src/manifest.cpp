@@ -0,0 +1,399 @@
+#include "sap_fs/manifest.h"
+#include "posix.h"
+#include "tree_helpers.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <dirent.h>
+
+namespace sap::fs {
+
+    namespace {
+
+        constexpr char s_Magic[4] = {'S', 'A', 'P', 'M'};
+        constexpr u32 s_Version = 1;
+
+        struct FileHeader {
+            char magic[4];
+            u32 version;
+            u64 entry_count;
+            u64 string_bytes;
+        };
+
+        // 64-bit FNV-1a over the file contents
+        std::optional<u64> hash_file(int dir_fd, const char* name) {
+            detail::UniqueFd fd{::openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)};
+            if (!fd) {
+                return std::nullopt;
+            }
+            u64 hash = 0xcbf29ce484222325ull;
+            u8 buffer[64 * 1024];
+            for (;;) {
+                ssize_t n = ::read(fd.get(), buffer, sizeof(buffer));
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return std::nullopt;
+                }
+                if (n == 0)
+                    break;
+                for (ssize_t i = 0; i < n; ++i) {
+                    hash = (hash ^ buffer[i]) * 0x100000001b3ull;
+                }
+            }
+            return hash;
+        }
+
+    } // namespace
+
+    int compare_paths(std::string_view lhs, std::string_view rhs) {
+        size_t n = std::min(lhs.size(), rhs.size());
+        for (size_t i = 0; i < n; ++i) {
+            auto a = static_cast<unsigned char>(lhs[i]);
+            auto b = static_cast<unsigned char>(rhs[i]);
+            if (a == b)
+                continue;
+            if (a == '/')
+                return -1;
+            if (b == '/')
+                return 1;
+            return a < b ? -1 : 1;
+        }
+        if (lhs.size() == rhs.size())
+            return 0;
+        return lhs.size() < rhs.size() ? -1 : 1;
+    }
+
+    std::string_view Manifest::root() const {
+        if (m_View.empty()) {
+            return {};
+        }
+        return path_of(m_View.front());
+    }
+
+    ManifestEntry Manifest::operator[](size_t index) const {
+        const auto& record = m_View[index];
+        ManifestEntry entry;
+        entry.path = path_of(record);
+        entry.size = record.size;
+        entry.mtime_ns = record.mtime_ns;
+        entry.inode = record.inode;
+        if (record.flags & s_FlagHasHash) {
+            entry.hash = record.hash;
+        }
+        entry.is_directory = (record.flags & s_FlagDirectory) != 0;
+        return entry;
+    }
+
+    size_t Manifest::lower_bound(std::string_view path) const {
+        auto it = std::partition_point(m_View.begin(), m_View.end(),
+                                       [&](const Record& record) { return compare_paths(path_of(record), path) < 0; });
+        return static_cast<size_t>(it - m_View.begin());
+    }
+
+    std::optional<ManifestEntry> Manifest::find(std::string_view path) const {
+        size_t index = lower_bound(path);
+        if (index == m_View.size() || path_of(m_View[index]) != path) {
+            return std::nullopt;
+        }
+        return (*this)[index];
+    }
+
+    stl::result<> Manifest::save(const std::filesystem::path& path) const {
+        FileHeader header{};
+        std::memcpy(header.magic, s_Magic, sizeof(s_Magic));
+        header.version = s_Version;
+        header.entry_count = m_View.size();
+        header.string_bytes = m_StringView.size();
+        // Unique sibling per save, so concurrent saves of the same manifest cannot clobber each other's staging file
+        auto tmp_path = detail::temp_path_for(path);
+        {
+            detail::UniqueFd fd{::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666)};
+            if (!fd) {
+                return stl::make_error("Failed to open file for writing: {}: {}", tmp_path.string(), detail::errno_message());
+            }
+            // Durable before the rename, so a crash leaves either the old or the complete new manifest
+            if (!detail::write_all(fd.get(), &header, sizeof(header)) ||
+                !detail::write_all(fd.get(), m_View.data(), m_View.size_bytes()) ||
+                !detail::write_all(fd.get(), m_StringView.data(), m_StringView.size()) || ::fdatasync(fd.get()) != 0) {
+                auto message = detail::errno_message();
+                ::unlink(tmp_path.c_str());
+                return stl::make_error("Failed to write manifest: {}", message);
+            }
+        }
+        if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            auto message = detail::errno_message();
+            ::unlink(tmp_path.c_str());
+            return stl::make_error("Failed to replace manifest: {}", message);
+        }
+        return stl::success;
+    }
+
+    stl::result<Manifest> Manifest::load(const std::filesystem::path& path) {
+        auto mapping = MappedFile::open(path);
+        if (!mapping) {
+            return stl::make_error<Manifest>("{}", mapping.error());
+        }
+        auto bytes = mapping.value().bytes();
+        FileHeader header{};
+        if (bytes.size() < sizeof(header)) {
+            return stl::make_error<Manifest>("Truncated manifest: {}", path.string());
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, s_Magic, sizeof(s_Magic)) != 0 || header.version != s_Version) {
+            return stl::make_error<Manifest>("Not a manifest or unsupported version: {}", path.string());
+        }
+        size_t available = bytes.size() - sizeof(header);
+        if (header.entry_count > available / sizeof(Record) ||
+            header.string_bytes != available - header.entry_count * sizeof(Record)) {
+            return stl::make_error<Manifest>("Corrupt manifest: {}", path.string());
+        }
+        Manifest manifest;
+        // The mapping is page aligned and the header keeps records 8-byte aligned
+        manifest.m_View = {reinterpret_cast<const Record*>(bytes.data() + sizeof(header)), header.entry_count};
+        manifest.m_StringView = {reinterpret_cast<const char*>(bytes.data() + sizeof(header) + manifest.m_View.size_bytes()),
+                                 header.string_bytes};
+        for (const auto& record : manifest.m_View) {
+            if (record.path_offset > header.string_bytes || record.path_length > header.string_bytes - record.path_offset) {
+                return stl::make_error<Manifest>("Corrupt manifest: {}", path.string());
+            }
+        }
+        manifest.m_Mapping = std::move(mapping.value());
+        return manifest;
+    }
+
+    struct Manifest::Scanner {
+        const Manifest* previous;
+        const ScanOptions& options;
+        Manifest out;
+
+        stl::result<> add(std::string_view path, const struct stat& st, u32 flags, std::optional<u64> hash) {
+            if (strings_exhausted(path.size())) {
+                return stl::make_error("Manifest string table exceeds 4 GiB");
+            }
+            Record record{};
+            record.size = S_ISDIR(st.st_mode) ? 0 : static_cast<u64>(st.st_size);
+            record.mtime_ns = detail::mtime_ns(st);
+            record.inode = static_cast<u64>(st.st_ino);
+            record.flags = flags;
+            if (hash) {
+                record.hash = *hash;
+                record.flags |= s_FlagHasHash;
+            }
+            record.path_offset = static_cast<u32>(out.m_Strings.size());
+            record.path_length = static_cast<u32>(path.size());
+            out.m_Strings.insert(out.m_Strings.end(), path.begin(), path.end());
+            out.m_Records.push_back(record);
+            return stl::success;
+        }
+
+        stl::result<> copy(const Record& record) {
+            auto path = previous->path_of(record);
+            if (strings_exhausted(path.size())) {
+                return stl::make_error("Manifest string table exceeds 4 GiB");
+            }
+            Record copied = record;
+            copied.path_offset = static_cast<u32>(out.m_Strings.size());
+            out.m_Strings.insert(out.m_Strings.end(), path.begin(), path.end());
+            out.m_Records.push_back(copied);
+            return stl::success;
+        }
+
+        bool strings_exhausted(size_t extra) const {
+            return out.m_Strings.size() + extra > std::numeric_limits<u32>::max();
+        }
+
+        static bool same_file(const Record& record, const struct stat& st) {
+            return record.size == static_cast<u64>(st.st_size) && record.mtime_ns == detail::mtime_ns(st) &&
+                   record.inode == static_cast<u64>(st.st_ino);
+        }
+
+        const Record* find_previous(std::string_view path) const {
+            if (!previous) {
+                return nullptr;
+            }
+            size_t index = previous->lower_bound(path);
+            if (index == previous->m_View.size() || previous->path_of(previous->m_View[index]) != path) {
+                return nullptr;
+            }
+            return &previous->m_View[index];
+        }
+
+        stl::result<> add_file(int dir_fd, const char* name, std::string_view path, const struct stat& st) {
+            std::optional<u64> hash;
+            if (options.hash_contents) {
+                const Record* old = find_previous(path);
+                if (old && (old->flags & s_FlagHasHash) && same_file(*old, st)) {
+                    hash = old->hash;
+                } else {
+                    hash = hash_file(dir_fd, name);
+                }
+            }
+            return add(path, st, 0, hash);
+        }
+
+        stl::result<> scan_dir(int fd, const std::string& path, const struct stat& st) {
+            if (auto result = add(path, st, s_FlagDirectory, std::nullopt); !result) {
+                return result;
+            }
+            const Record* old = find_previous(path);
+            if (old && (old->flags & s_FlagDirectory) && old->mtime_ns == detail::mtime_ns(st) &&
+                old->inode == static_cast<u64>(st.st_ino)) {
+                return reuse_dir(fd, path, static_cast<size_t>(old - previous->m_View.data()));
+            }
+            return read_dir(fd, path);
+        }
+
+        stl::result<> open_and_scan(int parent_fd, const char* name, const std::string& path) {
+            detail::UniqueFd child{::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)};
+            if (!child) {
+                // Vanished or replaced while scanning
+                if (errno == ENOENT || errno == ENOTDIR || errno == ELOOP)
+                    return stl::success;
+                return stl::make_error("Failed to open directory: {}: {}", path, detail::errno_message());
+            }
+            struct stat st{};
+            if (::fstat(child.get(), &st) != 0) {
+                return stl::make_error("Failed to stat directory: {}: {}", path, detail::errno_message());
+            }
+            return scan_dir(child.get(), path, st);
+        }
+
+        // The directory's entry list is unchanged: take its files from the previous snapshot and only
+        // descend into subdirectories to check their own mtimes
+        stl::result<> reuse_dir(int fd, std::string_view path, size_t index) {
+            const auto& records = previous->m_View;
+            std::string prefix = path.empty() ? std::string{} : detail::join_path(path, "");
+            size_t i = index + 1;
+            while (i < records.size()) {
+                auto child_path = previous->path_of(records[i]);
+                if (!child_path.starts_with(prefix))
+                    break;
+                std::string name{child_path.substr(prefix.size())};
+                if (records[i].flags & s_FlagDirectory) {
+                    if (auto result = open_and_scan(fd, name.c_str(), std::string{child_path}); !result) {
+                        return result;
+                    }
+                    // Skip the old subtree, it was rescanned above
+                    auto subtree_prefix = detail::join_path(child_path, "");
+                    auto end = std::partition_point(records.begin() + static_cast<std::ptrdiff_t>(i) + 1, records.end(),
+                                                    [&](const Record& r) { return previous->path_of(r).starts_with(subtree_prefix); });
+                    i = static_cast<size_t>(end - records.begin());
+                    continue;
+                }
+                if (options.stat_files) {
+                    struct stat st{};
+                    if (::fstatat(fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st.st_mode)) {
+                        auto result = same_file(records[i], st) ? copy(records[i]) : add_file(fd, name.c_str(), child_path, st);
+                        if (!result) {
+                            return result;
+                        }
+                    }
+                } else if (auto result = copy(records[i]); !result) {
+                    return result;
+                }
+                ++i;
+            }
+            return stl::success;
+        }
+
+        stl::result<> read_dir(int fd, const std::string& path) {
+            std::vector<std::string> names;
+            {
+                DIR* dir = ::fdopendir(::dup(fd));
+                if (!dir) {
+                    return stl::make_error("Failed to list directory: {}: {}", path, detail::errno_message());
+                }
+                while (auto* entry = ::readdir(dir)) {
+                    std::string_view name{entry->d_name};
+                    if (name == "." || name == "..")
+                        continue;
+                    names.emplace_back(name);
+                }
+                ::closedir(dir);
+            }
+            // Sorted names make the depth-first output ordered by compare_paths
+            std::sort(names.begin(), names.end());
+            for (const auto& name : names) {
+                struct stat st{};
+                if (::fstatat(fd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                auto child_path = detail::join_path(path, name);
+                stl::result<> result = stl::success;
+                if (S_ISDIR(st.st_mode)) {
+                    result = open_and_scan(fd, name.c_str(), child_path);
+                } else if (S_ISREG(st.st_mode)) {
+                    result = add_file(fd, name.c_str(), child_path, st);
+                }
+                if (!result) {
+                    return result;
+                }
+            }
+            return stl::success;
+        }
+    };
+
+    stl::result<Manifest> Manifest::scan(const std::filesystem::path& root, std::string_view relative_dir, const Manifest* previous,
+                                         const ScanOptions& options) {
+        auto dir_path = relative_dir.empty() ? root : root / relative_dir;
+        detail::UniqueFd fd{::open(dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!fd) {
+            return stl::make_error<Manifest>("Failed to open directory: {}: {}", dir_path.string(), detail::errno_message());
+        }
+        struct stat st{};
+        if (::fstat(fd.get(), &st) != 0) {
+            return stl::make_error<Manifest>("Failed to stat directory: {}", detail::errno_message());
+        }
+        Scanner scanner{previous, options, {}};
+        if (auto result = scanner.scan_dir(fd.get(), std::string{relative_dir}, st); !result) {
+            return stl::make_error<Manifest>("{}", result.error());
+        }
+        Manifest manifest = std::move(scanner.out);
+        manifest.m_View = manifest.m_Records;
+        manifest.m_StringView = {manifest.m_Strings.data(), manifest.m_Strings.size()};
+        return manifest;
+    }
+
+    ChangeSet diff(const Manifest& before, const Manifest& after) {
+        using Record = Manifest::Record;
+        auto is_file = [](const Record& record) { return (record.flags & Manifest::s_FlagDirectory) == 0; };
+        auto modified = [](const Record& lhs, const Record& rhs) {
+            if ((lhs.flags & Manifest::s_FlagHasHash) && (rhs.flags & Manifest::s_FlagHasHash)) {
+                return lhs.size != rhs.size || lhs.hash != rhs.hash;
+            }
+            return lhs.size != rhs.size || lhs.mtime_ns != rhs.mtime_ns || lhs.inode != rhs.inode;
+        };
+        ChangeSet changes;
+        const auto& lhs = before.m_View;
+        const auto& rhs = after.m_View;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < lhs.size() || j < rhs.size()) {
+            if (i < lhs.size() && !is_file(lhs[i])) {
+                ++i;
+                continue;
+            }
+            if (j < rhs.size() && !is_file(rhs[j])) {
+                ++j;
+                continue;
+            }
+            int order = i == lhs.size() ? 1 : j == rhs.size() ? -1 : compare_paths(before.path_of(lhs[i]), after.path_of(rhs[j]));
+            if (order < 0) {
+                changes.removed.emplace_back(before.path_of(lhs[i++]));
+            } else if (order > 0) {
+                changes.added.emplace_back(after.path_of(rhs[j++]));
+            } else {
+                if (modified(lhs[i], rhs[j])) {
+                    changes.modified.emplace_back(after.path_of(rhs[j]));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return changes;
+    }
+
+} // namespace sap::fs
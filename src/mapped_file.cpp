@@ -0,0 +1,78 @@
+#include "sap_fs/mapped_file.h"
+#include "posix.h"
+
+#include <sys/mman.h>
+
+namespace sap::fs {
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept :
+        m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() { unmap(); }
+
+    void MappedFile::unmap() {
+        if (m_Data) {
+            ::munmap(const_cast<u8*>(m_Data), m_Size);
+        }
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+    void MappedFile::advise(AccessHint hint) const {
+        if (!m_Data) {
+            return;
+        }
+        int advice = MADV_NORMAL;
+        switch (hint) {
+            case AccessHint::Normal:
+                advice = MADV_NORMAL;
+                break;
+            case AccessHint::Sequential:
+                advice = MADV_SEQUENTIAL;
+                break;
+            case AccessHint::Random:
+                advice = MADV_RANDOM;
+                break;
+            case AccessHint::WillNeed:
+                advice = MADV_WILLNEED;
+                break;
+            case AccessHint::DontNeed:
+                advice = MADV_DONTNEED;
+                break;
+        }
+        ::madvise(const_cast<u8*>(m_Data), m_Size, advice);
+    }
+
+    stl::result<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+        detail::UniqueFd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (!fd) {
+            return stl::make_error<MappedFile>("Failed to open file: {}: {}", path.string(), detail::errno_message());
+        }
+        struct stat st{};
+        if (::fstat(fd.get(), &st) != 0) {
+            return stl::make_error<MappedFile>("Failed to stat file: {}", detail::errno_message());
+        }
+        MappedFile mapped;
+        if (st.st_size == 0) {
+            // mmap rejects zero-length mappings
+            return mapped;
+        }
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (addr == MAP_FAILED) {
+            return stl::make_error<MappedFile>("Failed to map file: {}", detail::errno_message());
+        }
+        mapped.m_Data = static_cast<const u8*>(addr);
+        mapped.m_Size = static_cast<size_t>(st.st_size);
+        return mapped;
+    }
+
+} // namespace sap::fs
@@ -0,0 +1,46 @@
+#include "negative_cache.h"
+
+#include <unordered_map>
+
+namespace sap::fs::detail {
+
+    size_t NegativeCache::generation() {
+        std::lock_guard lock{m_Mutex};
+        return m_Generation;
+    }
+
+    bool NegativeCache::contains(const PathRef& key) {
+        std::lock_guard lock{m_Mutex};
+        auto it = m_Entries.find(key);
+        if (it == m_Entries.end()) {
+            return false;
+        }
+        if (it->second <= Clock::now()) {
+            m_Entries.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    void NegativeCache::insert(const PathRef& key, size_t generation) {
+        auto now = Clock::now();
+        std::lock_guard lock{m_Mutex};
+        if (generation != m_Generation) {
+            return;
+        }
+        if (m_Entries.size() >= s_MaxEntries) {
+            std::erase_if(m_Entries, [now](const auto& entry) { return entry.second <= now; });
+            if (m_Entries.size() >= s_MaxEntries) {
+                m_Entries.clear();
+            }
+        }
+        m_Entries.insert_or_assign(std::string{key.view()}, now + m_Ttl);
+    }
+
+    void NegativeCache::clear() {
+        std::lock_guard lock{m_Mutex};
+        ++m_Generation;
+        m_Entries.clear();
+    }
+
+} // namespace sap::fs::detail
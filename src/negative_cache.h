@@ -0,0 +1,56 @@
+#pragma once
+
+#include "path_key.h"
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace sap::fs::detail {
+
+    // Relative paths recently found missing, each remembered for a fixed TTL. Mutations that may create paths
+    // clear it through an Invalidation, which also bumps a generation so that a probe racing with the mutation
+    // cannot re-insert a stale miss.
+    class NegativeCache {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr size_t s_MaxEntries = 4096;
+
+        explicit NegativeCache(Clock::duration ttl) : m_Ttl(ttl) {}
+
+        // Generation to pass to insert() for a probe starting now
+        [[nodiscard]] size_t generation();
+        [[nodiscard]] bool contains(const PathRef& key);
+        // Remember a miss, unless an invalidation happened since generation was taken
+        void insert(const PathRef& key, size_t generation);
+        void clear();
+
+        // Clears the cache when the mutating scope ends; a null cache makes this a no-op
+        class Invalidation {
+        public:
+            explicit Invalidation(NegativeCache* cache) : m_Cache(cache) {}
+            Invalidation(const Invalidation&) = delete;
+            Invalidation& operator=(const Invalidation&) = delete;
+            ~Invalidation() {
+                if (m_Cache) {
+                    m_Cache->clear();
+                }
+            }
+
+        private:
+            NegativeCache* m_Cache;
+        };
+
+    private:
+
+        Clock::duration m_Ttl;
+        std::mutex m_Mutex;
+        size_t m_Generation = 0;
+        // Expiry time by path
+        std::unordered_map<std::string, Clock::time_point, PathKeyHash, PathKeyEqual> m_Entries;
+    };
+
+} // namespace sap::fs::detail
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "sap_fs/rel_path.h"
+
+#include <string>
+#include <string_view>
+
+namespace sap::fs::detail {
+
+    // Transparent hash and equality for std::string-keyed caches of relative paths, so PathRef lookups reuse
+    // the precomputed hash of a RelPath. Every key combination has its own overload to keep calls unambiguous.
+    struct PathKeyHash {
+        using is_transparent = void;
+        size_t operator()(const std::string& key) const { return static_cast<size_t>(fnv1a(key)); }
+        size_t operator()(std::string_view key) const { return static_cast<size_t>(fnv1a(key)); }
+        size_t operator()(const PathRef& key) const { return static_cast<size_t>(key.hash()); }
+    };
+
+    struct PathKeyEqual {
+        using is_transparent = void;
+        bool operator()(const std::string& a, const std::string& b) const { return a == b; }
+        bool operator()(const std::string& a, std::string_view b) const { return a == b; }
+        bool operator()(std::string_view a, const std::string& b) const { return a == b; }
+        bool operator()(const std::string& a, const PathRef& b) const { return a == b.view(); }
+        bool operator()(const PathRef& a, const std::string& b) const { return a.view() == b; }
+    };
+
+} // namespace sap::fs::detail
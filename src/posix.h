@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "sap_fs/io.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <linux/openat2.h>
+#include <sys/syscall.h>
+
+// sap_fs targets Linux only (glibc 2.28+, kernel headers 5.6+). Kernel features that may be missing at run time
+// (openat2, copy_file_range, reflinks, OFD locks, RENAME_EXCHANGE) are detected through their errors, not #if.
+namespace sap::fs::detail {
+
+    // Human readable message for an errno value
+    inline std::string errno_message(int err = errno) { return std::error_code{err, std::generic_category()}.message(); }
+
+    // Modification time of a stat result in nanoseconds since epoch
+    inline long long mtime_ns(const struct stat& st) {
+        return static_cast<long long>(st.st_mtim.tv_sec) * 1'000'000'000LL + st.st_mtim.tv_nsec;
+    }
+
+    // Forward an access hint to posix_fadvise. DontNeed only takes effect after the data was read, so callers
+    // apply it with drop_cache() once they are done.
+    inline void advise(int fd, AccessHint hint) {
+        switch (hint) {
+            case AccessHint::Normal:
+            case AccessHint::DontNeed:
+                break;
+            case AccessHint::Sequential:
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                break;
+            case AccessHint::Random:
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+                break;
+            case AccessHint::WillNeed:
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+                break;
+        }
+    }
+
+    // Evict a file's clean pages from the page cache
+    inline void drop_cache(int fd) { ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED); }
+
+    // Read until size bytes or EOF, retrying on EINTR. Returns the byte count, or -1 with errno set.
+    inline ssize_t read_full(int fd, void* data, size_t size) {
+        auto* bytes = static_cast<unsigned char*>(data);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::read(fd, bytes + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            if (n == 0)
+                break;
+            done += static_cast<size_t>(n);
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    // Write a whole buffer, retrying on short writes and EINTR. Returns false with errno set on failure.
+    inline bool write_all(int fd, const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        while (size > 0) {
+            ssize_t n = ::write(fd, bytes, size);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Drop n transferred bytes from the front of an iovec array
+    inline void advance_iovecs(struct iovec*& iov, int& count, size_t n) {
+        while (count > 0 && n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<unsigned char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    // Scatter-read at an offset until the buffers are full or EOF, retrying on EINTR. Modifies the iovecs.
+    // Returns the byte count, or -1 with errno set.
+    inline ssize_t preadv_full(int fd, struct iovec* iov, int count, off_t offset) {
+        size_t done = 0;
+        while (count > 0) {
+            ssize_t n = ::preadv(fd, iov, count, offset + static_cast<off_t>(done));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            if (n == 0)
+                break;
+            done += static_cast<size_t>(n);
+            advance_iovecs(iov, count, static_cast<size_t>(n));
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    // Read from an offset until size bytes or EOF without moving the file position, so shared descriptors
+    // can be read concurrently. Returns the byte count, or -1 with errno set.
+    inline ssize_t pread_full(int fd, void* data, size_t size, off_t offset) {
+        struct iovec iov{data, size};
+        return preadv_full(fd, &iov, 1, offset);
+    }
+
+    // Gather-write all buffers at an offset, retrying on short writes and EINTR. Modifies the iovecs.
+    // Returns false with errno set on failure.
+    inline bool pwritev_all(int fd, struct iovec* iov, int count, off_t offset) {
+        while (count > 0) {
+            ssize_t n = ::pwritev(fd, iov, count, offset);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            offset += n;
+            advance_iovecs(iov, count, static_cast<size_t>(n));
+        }
+        return true;
+    }
+
+    // Write a whole buffer at an offset without moving the file position. Returns false with errno set on failure.
+    inline bool pwrite_all(int fd, const void* data, size_t size, off_t offset) {
+        struct iovec iov{const_cast<void*>(data), size};
+        return pwritev_all(fd, &iov, 1, offset);
+    }
+
+    // Open path relative to dirfd without letting its resolution leave dirfd (openat2 with RESOLVE_BENEATH). Callers
+    // must reject ".." components first. Without openat2 only single-component paths are opened, and never through
+    // a symlink. Returns -1 with errno set on failure.
+    inline int open_beneath(int dirfd, const char* path, int flags, mode_t mode = 0) {
+        struct open_how how{};
+        how.flags = static_cast<unsigned long long>(flags | O_CLOEXEC);
+        // openat2 rejects a mode unless a file may be created
+        how.mode = (flags & O_CREAT) ? mode : 0;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        int fd = static_cast<int>(::syscall(SYS_openat2, dirfd, path, &how, sizeof(how)));
+        if (fd >= 0 || errno != ENOSYS) {
+            return fd;
+        }
+        if (std::strchr(path, '/') != nullptr) {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        return ::openat(dirfd, path, flags | O_CLOEXEC | O_NOFOLLOW, mode);
+    }
+
+    // Unique hidden sibling of path, for staging content that is renamed over it
+    inline std::filesystem::path temp_path_for(const std::filesystem::path& path) {
+        static std::atomic<unsigned long long> s_Counter{0};
+        auto name = "." + path.filename().string() + "." + std::to_string(::getpid()) + "." + std::to_string(s_Counter++) + ".tmp";
+        return path.parent_path() / name;
+    }
+
+    // Give a staged replacement the permission bits and, where permitted, the owner of the file it replaces
+    inline bool keep_attributes(int fd, const struct stat& existing) {
+        return ::fchmod(fd, existing.st_mode & 07777) == 0 && (::fchown(fd, existing.st_uid, existing.st_gid) == 0 || errno == EPERM);
+    }
+
+    // As above, by path; a target that does not exist leaves the staged file as it was created
+    inline bool keep_attributes(const std::filesystem::path& staged, const std::filesystem::path& target) {
+        struct stat existing{};
+        if (::stat(target.c_str(), &existing) != 0) {
+            return true;
+        }
+        return ::chmod(staged.c_str(), existing.st_mode & 07777) == 0 &&
+               (::chown(staged.c_str(), existing.st_uid, existing.st_gid) == 0 || errno == EPERM);
+    }
+
+    // Owning file descriptor
+    class UniqueFd {
+    public:
+        UniqueFd() = default;
+        explicit UniqueFd(int fd) : m_Fd(fd) {}
+        UniqueFd(UniqueFd&& other) noexcept : m_Fd(std::exchange(other.m_Fd, -1)) {}
+        UniqueFd& operator=(UniqueFd&& other) noexcept {
+            if (this != &other) {
+                reset(std::exchange(other.m_Fd, -1));
+            }
+            return *this;
+        }
+        UniqueFd(const UniqueFd&) = delete;
+        UniqueFd& operator=(const UniqueFd&) = delete;
+        ~UniqueFd() { reset(); }
+
+        [[nodiscard]] int get() const { return m_Fd; }
+        [[nodiscard]] explicit operator bool() const { return m_Fd >= 0; }
+        int release() { return std::exchange(m_Fd, -1); }
+        void reset(int fd = -1) {
+            if (m_Fd >= 0) {
+                ::close(m_Fd);
+            }
+            m_Fd = fd;
+        }
+
+    private:
+        int m_Fd = -1;
+    };
+
+} // namespace sap::fs::detail
@@ -0,0 +1,78 @@
+#include "range_io.h"
+#include "posix.h"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        constexpr size_t s_MaxIovecs = IOV_MAX;
+
+    } // namespace
+
+    stl::result<std::vector<std::vector<u8>>> read_ranges(int fd, std::span<const ByteRange> ranges) {
+        std::vector<std::vector<u8>> buffers(ranges.size());
+        std::vector<size_t> order(ranges.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::ranges::stable_sort(order, {}, [&](size_t i) { return ranges[i].offset; });
+        std::erase_if(order, [&](size_t i) { return ranges[i].length == 0; });
+
+        std::vector<struct iovec> iovecs;
+        iovecs.reserve(std::min(order.size(), s_MaxIovecs));
+        for (size_t begin = 0; begin < order.size();) {
+            // Grow the batch while the next range starts exactly where the previous one ended
+            u64 offset = ranges[order[begin]].offset;
+            u64 end = offset;
+            size_t batch_end = begin;
+            iovecs.clear();
+            while (batch_end < order.size() && iovecs.size() < s_MaxIovecs && ranges[order[batch_end]].offset == end) {
+                const auto& range = ranges[order[batch_end]];
+                auto& buffer = buffers[order[batch_end]];
+                buffer.resize(range.length);
+                iovecs.push_back({buffer.data(), buffer.size()});
+                end += range.length;
+                ++batch_end;
+            }
+            ssize_t n = preadv_full(fd, iovecs.data(), static_cast<int>(iovecs.size()), static_cast<off_t>(offset));
+            if (n < 0) {
+                return stl::make_error<std::vector<std::vector<u8>>>("Failed to read file: {}", errno_message());
+            }
+            // Trim the ranges that extend past EOF
+            auto remaining = static_cast<size_t>(n);
+            for (size_t i = begin; i < batch_end; ++i) {
+                auto& buffer = buffers[order[i]];
+                buffer.resize(std::min(buffer.size(), remaining));
+                remaining -= buffer.size();
+            }
+            begin = batch_end;
+        }
+        return buffers;
+    }
+
+    bool write_ranges(int fd, std::span<const RangeWrite> writes) {
+        // Request order is kept so that a later write to overlapping bytes wins
+        std::vector<struct iovec> iovecs;
+        iovecs.reserve(std::min(writes.size(), s_MaxIovecs));
+        for (size_t begin = 0; begin < writes.size();) {
+            u64 offset = writes[begin].offset;
+            u64 end = offset;
+            size_t batch_end = begin;
+            iovecs.clear();
+            while (batch_end < writes.size() && iovecs.size() < s_MaxIovecs && writes[batch_end].offset == end) {
+                auto data = writes[batch_end].data;
+                iovecs.push_back({const_cast<u8*>(data.data()), data.size()});
+                end += data.size();
+                ++batch_end;
+            }
+            if (!pwritev_all(fd, iovecs.data(), static_cast<int>(iovecs.size()), static_cast<off_t>(offset))) {
+                return false;
+            }
+            begin = batch_end;
+        }
+        return true;
+    }
+
+} // namespace sap::fs::detail
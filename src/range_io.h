@@ -0,0 +1,21 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+
+#include "sap_fs/io.h"
+
+#include <span>
+#include <vector>
+
+namespace sap::fs::detail {
+
+    // Read each range from fd into its own buffer, truncated at EOF. Ranges that are exactly adjacent in the
+    // file are fetched together with one preadv.
+    [[nodiscard]] stl::result<std::vector<std::vector<u8>>> read_ranges(int fd, std::span<const ByteRange> ranges);
+
+    // Write each range to fd in the order given, merging runs of exactly adjacent ranges into one pwritev.
+    // Returns false with errno set on failure.
+    [[nodiscard]] bool write_ranges(int fd, std::span<const RangeWrite> writes);
+
+} // namespace sap::fs::detail
@@ -0,0 +1,105 @@
+#include "remove_tree.h"
+#include "posix.h"
+#include "thread_pool.h"
+#include "tree_helpers.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+namespace sap::fs::detail {
+
+    namespace {
+
+        class TreeRemover {
+        public:
+            // Open the subdirectory name of parent_fd, empty it, then remove it from parent_fd
+            void remove_directory(int parent_fd, const char* name) {
+                int fd = ::openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (fd < 0) {
+                    if (errno == ENOTDIR || errno == ELOOP) {
+                        // Replaced by a file or symlink since it was listed
+                        unlink(parent_fd, name, 0);
+                    } else if (errno != ENOENT) {
+                        fail(name);
+                    }
+                    return;
+                }
+                remove_contents(fd, name);
+                unlink(parent_fd, name, AT_REMOVEDIR);
+            }
+
+            [[nodiscard]] const std::optional<std::string>& error() const { return m_Error.message(); }
+
+        private:
+            FirstError m_Error;
+
+            // Remove everything inside the directory open as dirfd (takes ownership), named dir_name in its parent
+            void remove_contents(int dirfd, const char* dir_name) {
+                DIR* dir = ::fdopendir(dirfd);
+                if (!dir) {
+                    fail(dir_name);
+                    ::close(dirfd);
+                    return;
+                }
+                int fd = ::dirfd(dir);
+                std::vector<std::string> subdirectories;
+                while (const dirent* entry = ::readdir(dir)) {
+                    std::string_view name = entry->d_name;
+                    if (name == "." || name == "..") {
+                        continue;
+                    }
+                    if (entry_type(fd, *entry) == DT_DIR) {
+                        subdirectories.emplace_back(name);
+                    } else if (::unlinkat(fd, entry->d_name, 0) != 0) {
+                        if (errno == EISDIR) {
+                            subdirectories.emplace_back(name);
+                        } else if (errno != ENOENT) {
+                            fail(entry->d_name);
+                        }
+                    }
+                }
+                ThreadPool::shared().parallel_for(subdirectories.size(),
+                                                  [&](size_t i) { remove_directory(fd, subdirectories[i].c_str()); });
+                ::closedir(dir);
+            }
+
+            void unlink(int parent_fd, const char* name, int flags) {
+                if (::unlinkat(parent_fd, name, flags) != 0 && errno != ENOENT) {
+                    fail(name);
+                }
+            }
+
+            void fail(const char* name) {
+                int err = errno;
+                m_Error.set(std::string{"Failed to remove "} + name + ": " + errno_message(err));
+            }
+        };
+
+    } // namespace
+
+    stl::result<> remove_tree(int parent_fd, const char* name) {
+        struct stat st{};
+        if (::fstatat(parent_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            if (errno == ENOENT) {
+                return stl::success;
+            }
+            return stl::make_error("Failed to stat {}: {}", name, errno_message());
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            if (::unlinkat(parent_fd, name, 0) != 0 && errno != ENOENT) {
+                return stl::make_error("Failed to remove {}: {}", name, errno_message());
+            }
+            return stl::success;
+        }
+        TreeRemover remover;
+        remover.remove_directory(parent_fd, name);
+        if (remover.error()) {
+            return stl::make_error("{}", *remover.error());
+        }
+        return stl::success;
+    }
+
+} // namespace sap::fs::detail
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <sap_core/result.h>
+
+namespace sap::fs::detail {
+
+    // Remove the entry name inside parent_fd and, if it is a directory, everything below it. Subdirectories are
+    // emptied in parallel on the shared thread pool (post-order), using only dirfd-relative unlinkat. Symlinks are
+    // removed, never followed. A missing entry is not an error.
+    [[nodiscard]] stl::result<> remove_tree(int parent_fd, const char* name);
+
+} // namespace sap::fs::detail
@@ -0,0 +1,85 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace sap::fs::detail {
+
+    ThreadPool::ThreadPool(size_t threads) {
+        m_Workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            m_Workers.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock{m_Mutex};
+            m_Stopping = true;
+        }
+        m_Wake.notify_all();
+        for (auto& worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::shared() {
+        static ThreadPool pool{std::max(2u, std::thread::hardware_concurrency())};
+        return pool;
+    }
+
+    void ThreadPool::submit(std::function<void()> task) {
+        {
+            std::lock_guard lock{m_Mutex};
+            m_Tasks.push_back(std::move(task));
+        }
+        m_Wake.notify_one();
+    }
+
+    void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) {
+            return;
+        }
+        struct State {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto state = std::make_shared<State>();
+        auto run = [state, count, &fn] {
+            for (size_t i = state->next++; i < count; i = state->next++) {
+                fn(i);
+                if (++state->done == count) {
+                    std::lock_guard lock{state->mutex};
+                    state->finished.notify_all();
+                }
+            }
+        };
+        size_t helpers = std::min(count - 1, size());
+        for (size_t i = 0; i < helpers; ++i) {
+            submit(run);
+        }
+        run();
+        std::unique_lock lock{state->mutex};
+        state->finished.wait(lock, [&] { return state->done.load() == count; });
+    }
+
+    void ThreadPool::worker_loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock{m_Mutex};
+                m_Wake.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+                if (m_Tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+} // namespace sap::fs::detail
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sap::fs::detail {
+
+    // Fixed-size worker pool for background and fan-out filesystem work
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Process-wide pool sized to the hardware concurrency
+        static ThreadPool& shared();
+
+        [[nodiscard]] size_t size() const { return m_Workers.size(); }
+        // Queue a task; fire and forget
+        void submit(std::function<void()> task);
+        // Run fn(i) for every i in [0, count) and return once all calls finished. The calling thread takes part,
+        // so this is safe to call from inside a pool task.
+        void parallel_for(size_t count, const std::function<void(size_t)>& fn);
+
+    private:
+        std::vector<std::thread> m_Workers;
+        std::deque<std::function<void()>> m_Tasks;
+        std::mutex m_Mutex;
+        std::condition_variable m_Wake;
+        bool m_Stopping = false;
+
+        void worker_loop();
+    };
+
+} // namespace sap::fs::detail
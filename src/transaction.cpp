@@ -0,0 +1,226 @@
+#include "sap_fs/transaction.h"
+#include "lock_stripes.h"
+#include "negative_cache.h"
+#include "posix.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace sap::fs {
+
+    namespace fs = std::filesystem;
+
+    namespace {
+
+        // A change that has been applied and can be rolled back
+        struct Applied {
+            const fs::path* target;
+            // Previous content, moved aside; empty if the target did not exist
+            fs::path backup;
+            bool is_remove;
+        };
+
+        // Move target aside to a backup, if it exists. Returns false with errno set on failure.
+        bool move_aside(const fs::path& target, fs::path& backup) {
+            auto aside = detail::temp_path_for(target);
+            if (::rename(target.c_str(), aside.c_str()) != 0) {
+                return errno == ENOENT;
+            }
+            backup = std::move(aside);
+            return true;
+        }
+
+        // Put staged in place of target, leaving the previous content (if any) in backup.
+        // Returns false with errno set on failure.
+        bool swap_in(const fs::path& staged, const fs::path& target, fs::path& backup) {
+            // One atomic step: the old file ends up under the staged name
+            if (::renameat2(AT_FDCWD, staged.c_str(), AT_FDCWD, target.c_str(), RENAME_EXCHANGE) == 0) {
+                backup = staged;
+                return true;
+            }
+            if (errno == ENOENT) {
+                return ::rename(staged.c_str(), target.c_str()) == 0;
+            }
+            if (errno != EINVAL && errno != ENOSYS) {
+                return false;
+            }
+            // No exchange support: the target is briefly missing between the two renames
+            if (!move_aside(target, backup)) {
+                return false;
+            }
+            if (::rename(staged.c_str(), target.c_str()) != 0) {
+                int err = errno;
+                if (!backup.empty() && ::rename(backup.c_str(), target.c_str()) == 0) {
+                    backup.clear();
+                }
+                errno = err;
+                return false;
+            }
+            return true;
+        }
+
+        void roll_back(std::span<const Applied> applied) {
+            for (auto it = applied.rbegin(); it != applied.rend(); ++it) {
+                if (!it->backup.empty()) {
+                    ::rename(it->backup.c_str(), it->target->c_str());
+                } else if (!it->is_remove) {
+                    ::unlink(it->target->c_str());
+                }
+            }
+        }
+
+        bool sync_path(const fs::path& path, int flags) {
+            detail::UniqueFd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC | flags)};
+            return fd && ::fsync(fd.get()) == 0;
+        }
+
+    } // namespace
+
+    Transaction::Transaction(Filesystem filesystem) : m_Filesystem(std::move(filesystem)) {}
+
+    Transaction& Transaction::operator=(Transaction&& other) noexcept {
+        if (this != &other) {
+            discard();
+            m_Filesystem = std::move(other.m_Filesystem);
+            m_Changes = std::move(other.m_Changes);
+        }
+        return *this;
+    }
+
+    Transaction::~Transaction() { discard(); }
+
+    stl::result<> Transaction::write(PathRef relative_path, std::span<const u8> content, const WriteOptions& options) {
+        return stage(relative_path, content, &options);
+    }
+
+    stl::result<> Transaction::write(PathRef relative_path, std::string_view content, const WriteOptions& options) {
+        return stage(relative_path, {reinterpret_cast<const u8*>(content.data()), content.size()}, &options);
+    }
+
+    stl::result<> Transaction::remove(PathRef relative_path) { return stage(relative_path, {}, nullptr); }
+
+    stl::result<> Transaction::stage(PathRef relative_path, std::span<const u8> content, const WriteOptions* options) {
+        // Staging creates parent directories
+        detail::NegativeCache::Invalidation invalidation{m_Filesystem.m_Missing.get()};
+        auto path_result = m_Filesystem.validate_path(relative_path);
+        if (!path_result) {
+            return stl::make_error("{}", path_result.error());
+        }
+        Change change{.target = std::move(path_result.value()), .staged = {}};
+        std::error_code ec;
+        if (fs::is_directory(fs::symlink_status(change.target, ec))) {
+            return stl::make_error("Cannot replace a directory: {}", change.target.string());
+        }
+        if (options) {
+            if (auto result = Filesystem::create_parent_directories(change.target); !result) {
+                return result;
+            }
+            change.staged = detail::temp_path_for(change.target);
+            if (auto result = Filesystem::write_file(change.staged, content, *options); !result) {
+                ::unlink(change.staged.c_str());
+                return result;
+            }
+        }
+        auto existing = std::ranges::find(m_Changes, change.target, &Change::target);
+        if (existing == m_Changes.end()) {
+            m_Changes.push_back(std::move(change));
+            return stl::success;
+        }
+        if (!existing->staged.empty()) {
+            ::unlink(existing->staged.c_str());
+        }
+        *existing = std::move(change);
+        return stl::success;
+    }
+
+    void Transaction::discard() {
+        for (const auto& change : m_Changes) {
+            if (!change.staged.empty()) {
+                ::unlink(change.staged.c_str());
+            }
+        }
+        m_Changes.clear();
+    }
+
+    stl::result<> Transaction::commit() {
+        auto changes = std::exchange(m_Changes, {});
+        auto discard_staged = [&changes] {
+            for (const auto& change : changes) {
+                if (!change.staged.empty()) {
+                    ::unlink(change.staged.c_str());
+                }
+            }
+        };
+
+        // Staged content must be on disk before any rename can make it visible
+        std::vector<int> sync_errors(changes.size(), 0);
+        detail::ThreadPool::shared().parallel_for(changes.size(), [&](size_t i) {
+            if (!changes[i].staged.empty() && !sync_path(changes[i].staged, 0)) {
+                sync_errors[i] = errno;
+            }
+        });
+        for (size_t i = 0; i < changes.size(); ++i) {
+            if (sync_errors[i] != 0) {
+                discard_staged();
+                return stl::make_error("Failed to sync {}: {}", changes[i].target.string(), detail::errno_message(sync_errors[i]));
+            }
+        }
+
+        std::vector<fs::path> targets;
+        targets.reserve(changes.size());
+        for (const auto& change : changes) {
+            targets.push_back(change.target);
+        }
+        detail::StripeSetGuard guard{m_Filesystem.m_Locks.get(), targets};
+        detail::NegativeCache::Invalidation invalidation{m_Filesystem.m_Missing.get()};
+
+        std::vector<Applied> applied;
+        applied.reserve(changes.size());
+        for (auto& change : changes) {
+            Applied step{.target = &change.target, .backup = {}, .is_remove = change.staged.empty()};
+            // Like Filesystem::write in Striped mode, a replaced file keeps its mode and, where permitted, its owner
+            bool ok = step.is_remove ? move_aside(change.target, step.backup)
+                                     : detail::keep_attributes(change.staged, change.target) &&
+                                           swap_in(change.staged, change.target, step.backup);
+            if (!ok) {
+                int err = errno;
+                roll_back(applied);
+                discard_staged();
+                return stl::make_error("Failed to commit {}: {}", change.target.string(), detail::errno_message(err));
+            }
+            // The staged name is either gone or now holds the backup
+            change.staged.clear();
+            applied.push_back(std::move(step));
+        }
+
+        // One barrier per directory makes every rename in it durable. Removes of files that did not exist changed
+        // nothing, and their directory may not exist either.
+        std::vector<fs::path> directories;
+        directories.reserve(applied.size());
+        for (const auto& step : applied) {
+            if (!step.is_remove || !step.backup.empty()) {
+                directories.push_back(step.target->parent_path());
+            }
+        }
+        std::ranges::sort(directories);
+        auto [first, last] = std::ranges::unique(directories);
+        directories.erase(first, last);
+        // The changes are in place by now and are kept even if a barrier fails; only their durability is unknown
+        stl::result<> result = stl::success;
+        for (const auto& directory : directories) {
+            if (!sync_path(directory, O_DIRECTORY)) {
+                result = stl::make_error("Committed, but failed to sync directory {}: {}", directory.string(), detail::errno_message());
+                break;
+            }
+        }
+
+        for (const auto& step : applied) {
+            if (!step.backup.empty()) {
+                ::unlink(step.backup.c_str());
+            }
+        }
+        return result;
+    }
+
+} // namespace sap::fs
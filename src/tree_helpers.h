@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace sap::fs::detail {
+
+    // First error reported by the workers of a parallel tree operation; later ones are dropped
+    class FirstError {
+    public:
+        void set(std::string message) {
+            std::lock_guard lock{m_Mutex};
+            if (!m_Message) {
+                m_Message = std::move(message);
+                m_Failed.store(true, std::memory_order_relaxed);
+            }
+        }
+        // Cheap check for workers that stop early
+        [[nodiscard]] bool failed() const { return m_Failed.load(std::memory_order_relaxed); }
+        // Only read once all workers have finished
+        [[nodiscard]] const std::optional<std::string>& message() const { return m_Message; }
+
+    private:
+        std::mutex m_Mutex;
+        std::atomic<bool> m_Failed{false};
+        std::optional<std::string> m_Message;
+    };
+
+    // d_type of a directory entry, falling back to fstatat (not following symlinks) on filesystems that report
+    // DT_UNKNOWN. Stays DT_UNKNOWN if the entry can no longer be stat'ed.
+    inline unsigned char entry_type(int dirfd, const dirent& entry) {
+        if (entry.d_type != DT_UNKNOWN) {
+            return entry.d_type;
+        }
+        struct stat st{};
+        if (::fstatat(dirfd, entry.d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return DT_UNKNOWN;
+        }
+        return IFTODT(st.st_mode);
+    }
+
+    // Join a '/'-separated relative directory and a name; an empty directory is the root
+    inline std::string join_path(std::string_view dir, std::string_view name) {
+        std::string path;
+        path.reserve(dir.size() + name.size() + 1);
+        path.append(dir);
+        if (!dir.empty()) {
+            path.push_back('/');
+        }
+        path.append(name);
+        return path;
+    }
+
+} // namespace sap::fs::detail
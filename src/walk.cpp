@@ -0,0 +1,185 @@
+#include "sap_fs/walk.h"
+#include "posix.h"
+
+#include <vector>
+
+#include <dirent.h>
+
+namespace sap::fs {
+
+    struct Walker::State {
+        struct Level {
+            DIR* dir;
+            // Length of this directory's path within `path`
+            size_t path_length;
+            dev_t device;
+            ino_t inode;
+        };
+
+        WalkOptions options;
+        std::vector<Level> levels;
+        std::string path;
+        // Offset of the last entry's name within `path`
+        size_t name_offset = 0;
+        WalkEntry entry;
+        bool descend_pending = false;
+        bool done = false;
+        std::optional<std::string> error;
+
+        State() = default;
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+        ~State() {
+            for (auto& level : levels) {
+                ::closedir(level.dir);
+            }
+        }
+
+        void fail(std::string message) {
+            error = std::move(message);
+            done = true;
+        }
+
+        // Push a directory stream for fd. Returns false (without error) for directories already on the stack.
+        bool push(detail::UniqueFd fd) {
+            struct stat st{};
+            if (::fstat(fd.get(), &st) != 0) {
+                fail("Failed to stat directory: " + path + ": " + detail::errno_message());
+                return false;
+            }
+            for (const auto& level : levels) {
+                // Symlink cycle
+                if (level.device == st.st_dev && level.inode == st.st_ino)
+                    return false;
+            }
+            DIR* dir = ::fdopendir(fd.get());
+            if (!dir) {
+                fail("Failed to list directory: " + path + ": " + detail::errno_message());
+                return false;
+            }
+            fd.release();
+            levels.push_back({dir, path.size(), st.st_dev, st.st_ino});
+            return true;
+        }
+
+        void descend() {
+            int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (options.follow_symlinks ? 0 : O_NOFOLLOW);
+            detail::UniqueFd fd{::openat(::dirfd(levels.back().dir), path.c_str() + name_offset, flags)};
+            if (!fd) {
+                if (errno == EACCES && options.skip_permission_denied)
+                    return;
+                // Removed or replaced since it was read
+                if (errno == ENOENT || errno == ENOTDIR || errno == ELOOP)
+                    return;
+                fail("Failed to list directory: " + path + ": " + detail::errno_message());
+                return;
+            }
+            push(std::move(fd));
+        }
+    };
+
+    Walker::Walker(std::string_view absolute_dir, std::string_view relative_dir, WalkOptions options) :
+        m_State(std::make_unique<State>()) {
+        m_State->options = std::move(options);
+        m_State->path = relative_dir;
+        detail::UniqueFd fd{::open(std::string{absolute_dir}.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (!fd) {
+            if (errno == ENOENT) {
+                // Nothing to walk
+                m_State->done = true;
+            } else if (errno == ENOTDIR) {
+                m_State->fail("Not a directory");
+            } else if (errno == EACCES && m_State->options.skip_permission_denied) {
+                m_State->done = true;
+            } else {
+                m_State->fail("Failed to list directory: " + detail::errno_message());
+            }
+            return;
+        }
+        m_State->push(std::move(fd));
+    }
+
+    Walker::Walker(std::optional<std::string> error) : m_State(std::make_unique<State>()) {
+        m_State->done = true;
+        m_State->error = std::move(error);
+    }
+
+    Walker::Walker(Walker&& other) noexcept = default;
+    Walker& Walker::operator=(Walker&& other) noexcept = default;
+    Walker::~Walker() = default;
+
+    const std::optional<std::string>& Walker::error() const { return m_State->error; }
+
+    void Walker::skip_subtree() { m_State->descend_pending = false; }
+
+    const WalkEntry* Walker::next() {
+        auto& s = *m_State;
+        if (s.done) {
+            return nullptr;
+        }
+        if (s.descend_pending) {
+            s.descend_pending = false;
+            s.descend();
+            if (s.done) {
+                return nullptr;
+            }
+        }
+        while (!s.levels.empty()) {
+            auto& level = s.levels.back();
+            errno = 0;
+            dirent* dirent = ::readdir(level.dir);
+            if (!dirent) {
+                if (errno != 0) {
+                    s.fail("Failed to list directory: " + detail::errno_message());
+                    return nullptr;
+                }
+                ::closedir(level.dir);
+                s.levels.pop_back();
+                continue;
+            }
+            std::string_view name{dirent->d_name};
+            if (name == "." || name == "..")
+                continue;
+            s.path.resize(level.path_length);
+            if (!s.path.empty()) {
+                s.path.push_back('/');
+            }
+            s.name_offset = s.path.size();
+            s.path.append(name);
+
+            // d_type saves a stat for everything except symlinks and filesystems that do not report it
+            EntryType type = EntryType::Other;
+            bool is_symlink = dirent->d_type == DT_LNK;
+            if (dirent->d_type == DT_REG) {
+                type = EntryType::File;
+            } else if (dirent->d_type == DT_DIR) {
+                type = EntryType::Directory;
+            } else if (dirent->d_type == DT_LNK || dirent->d_type == DT_UNKNOWN) {
+                struct stat st{};
+                int dir_fd = ::dirfd(level.dir);
+                if (dirent->d_type == DT_UNKNOWN && ::fstatat(dir_fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    is_symlink = S_ISLNK(st.st_mode);
+                }
+                if (::fstatat(dir_fd, dirent->d_name, &st, 0) == 0) {
+                    type = S_ISREG(st.st_mode) ? EntryType::File : S_ISDIR(st.st_mode) ? EntryType::Directory : EntryType::Other;
+                }
+            }
+
+            size_t depth = s.levels.size() - 1;
+            if (s.options.exclude.matches(s.path))
+                continue;
+            if (type != EntryType::Directory && !s.options.include.empty() && !s.options.include.matches(s.path))
+                continue;
+            if (type == EntryType::Directory) {
+                // Decided now so that prune and max_depth keep the subtree from ever being opened
+                s.descend_pending = (!is_symlink || s.options.follow_symlinks) && depth < s.options.max_depth &&
+                                    !(s.options.prune && s.options.prune(s.path));
+            }
+            s.entry = {s.path, type, is_symlink, depth};
+            return &s.entry;
+        }
+        s.done = true;
+        return nullptr;
+    }
+
+} // namespace sap::fs
@@ -0,0 +1,65 @@
+// Throughput of write() to distinct paths from 1..N threads, with and without Concurrency::Striped.
+// Different paths should scale with thread count in both modes.
+
+#include <sap_fs/fs.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    constexpr size_t s_WritesPerThread = 2000;
+    constexpr size_t s_FilesPerThread = 64;
+    constexpr size_t s_FileSize = 4096;
+
+    double writes_per_second(const fs::path& root, sap::fs::Concurrency concurrency, size_t thread_count) {
+        sap::fs::Filesystem filesystem{root, {.concurrency = concurrency}};
+        std::string content(s_FileSize, 'x');
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; ++t) {
+            threads.emplace_back([&, t] {
+                auto prefix = "t" + std::to_string(t) + "/f";
+                for (size_t i = 0; i < s_WritesPerThread; ++i) {
+                    if (!filesystem.write(prefix + std::to_string(i % s_FilesPerThread), content)) {
+                        std::fprintf(stderr, "write failed\n");
+                        std::exit(1);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(thread_count * s_WritesPerThread) / elapsed.count();
+    }
+
+} // namespace
+
+int main() {
+    std::string pattern = (fs::temp_directory_path() / "sap_fs_bench.XXXXXX").string();
+    if (!::mkdtemp(pattern.data())) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    fs::path root = pattern;
+    size_t max_threads = std::max<size_t>(8, std::thread::hardware_concurrency());
+    std::printf("%8s %16s %16s\n", "threads", "none writes/s", "striped writes/s");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double none = writes_per_second(root, sap::fs::Concurrency::None, threads);
+        double striped = writes_per_second(root, sap::fs::Concurrency::Striped, threads);
+        std::printf("%8zu %16.0f %16.0f\n", threads, none, striped);
+    }
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return 0;
+}
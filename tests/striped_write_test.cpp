@@ -0,0 +1,163 @@
+// Concurrency::Striped: concurrent writers and copies onto one path never expose a torn file to readers, and
+// replacing a file keeps its mode. Exits non-zero on failure.
+
+#include <sap_fs/fs.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+
+    namespace fs = std::filesystem;
+
+    constexpr size_t s_Writers = 2;
+    constexpr size_t s_Readers = 4;
+    constexpr size_t s_WritesPerWriter = 200;
+    constexpr size_t s_Chunk = 16 * 1024;
+
+    int g_Failures = 0;
+
+    void check(bool condition, const char* what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAIL: %s\n", what);
+            ++g_Failures;
+        }
+    }
+
+    fs::path make_root() {
+        std::string pattern = (fs::temp_directory_path() / "sap_fs_test.XXXXXX").string();
+        if (!::mkdtemp(pattern.data())) {
+            std::perror("mkdtemp");
+            std::exit(1);
+        }
+        return pattern;
+    }
+
+    // Every write is one repeated character and a whole number of chunks, so any mix of two writes is detectable
+    bool is_whole(const std::vector<u8>& content) {
+        if (content.empty() || content.size() % s_Chunk != 0) {
+            return false;
+        }
+        for (u8 byte : content) {
+            if (byte != content.front()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void test_readers_never_see_torn_writes(const fs::path& root) {
+        sap::fs::Filesystem filesystem{root, {.concurrency = sap::fs::Concurrency::Striped}};
+        check(filesystem.write("shared.bin", std::string(s_Chunk, 'x')).has_value(), "initial write");
+
+        std::atomic<bool> done{false};
+        std::atomic<size_t> reads{0};
+        std::atomic<size_t> torn{0};
+        std::atomic<size_t> failed{0};
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r < s_Readers; ++r) {
+            threads.emplace_back([&] {
+                while (!done.load()) {
+                    auto content = filesystem.read("shared.bin");
+                    if (!content) {
+                        ++failed;
+                    } else if (!is_whole(content.value())) {
+                        ++torn;
+                    }
+                    ++reads;
+                }
+            });
+        }
+        std::vector<std::thread> writers;
+        for (size_t w = 0; w < s_Writers; ++w) {
+            writers.emplace_back([&, w] {
+                for (size_t i = 0; i < s_WritesPerWriter; ++i) {
+                    std::string content((i % 8 + 1) * s_Chunk, static_cast<char>('a' + w));
+                    if (!filesystem.write("shared.bin", content)) {
+                        ++failed;
+                    }
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        done = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        check(failed == 0, "no read or write fails");
+        check(torn == 0, "readers never see a torn file");
+        check(reads > 0, "readers ran");
+        auto last = filesystem.read("shared.bin");
+        check(last && is_whole(last.value()), "final content is one complete write");
+    }
+
+    void test_replacing_keeps_mode(const fs::path& root) {
+        sap::fs::Filesystem filesystem{root, {.concurrency = sap::fs::Concurrency::Striped}};
+        check(filesystem.write("script.sh", std::string_view{"#!/bin/sh\n"}).has_value(), "write script");
+        ::chmod((root / "script.sh").c_str(), 0700);
+        check(filesystem.write("script.sh", std::string_view{"#!/bin/sh\nexit 0\n"}).has_value(), "rewrite script");
+        struct stat st{};
+        check(::stat((root / "script.sh").c_str(), &st) == 0 && (st.st_mode & 07777) == 0700, "mode survives a striped write");
+    }
+
+    void test_copy_replaces_atomically(const fs::path& root) {
+        sap::fs::Filesystem filesystem{root, {.concurrency = sap::fs::Concurrency::Striped}};
+        check(filesystem.write("small.bin", std::string(s_Chunk, 's')).has_value(), "write small source");
+        check(filesystem.write("large.bin", std::string(8 * s_Chunk, 'l')).has_value(), "write large source");
+        check(filesystem.copy("small.bin", "copy.bin").has_value(), "initial copy");
+        ::chmod((root / "copy.bin").c_str(), 0600);
+
+        std::atomic<bool> done{false};
+        std::atomic<size_t> torn{0};
+        std::atomic<size_t> failed{0};
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < s_Readers; ++r) {
+            readers.emplace_back([&] {
+                while (!done.load()) {
+                    auto content = filesystem.read("copy.bin");
+                    if (!content) {
+                        ++failed;
+                    } else if (!is_whole(content.value())) {
+                        ++torn;
+                    }
+                }
+            });
+        }
+        for (size_t i = 0; i < s_WritesPerWriter; ++i) {
+            if (!filesystem.copy(i % 2 == 0 ? "large.bin" : "small.bin", "copy.bin")) {
+                ++failed;
+            }
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        check(failed == 0, "no read or copy fails");
+        check(torn == 0, "readers never see a partly copied file");
+        struct stat st{};
+        check(::stat((root / "copy.bin").c_str(), &st) == 0 && (st.st_mode & 07777) == 0600, "mode survives a striped copy");
+    }
+
+} // namespace
+
+int main() {
+    auto root = make_root();
+    test_readers_never_see_torn_writes(root);
+    test_replacing_keeps_mode(root);
+    test_copy_replaces_atomically(root);
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    if (g_Failures == 0) {
+        std::printf("OK\n");
+    }
+    return g_Failures == 0 ? 0 : 1;
+}